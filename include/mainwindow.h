@@ -6,12 +6,19 @@
 #include <array>
 #include <cstdint>
 
+#include "perfcounters.h"
+
 class MainWindow : public QOpenGLWidget
 {
 public:
     MainWindow();
     ~MainWindow();
 
+    void setPerfCounters(PerfCounters* perfCounters) { this->perfCounters = perfCounters; }
+
+    //RGBA pixels, top line first, shown on the next repaint
+    void setFrame(const uint32_t* frame);
+
 private:
     void paintGL() override;
     void resizeGL(int w, int h) override;
@@ -19,7 +26,10 @@ private:
 
     static constexpr int nesWidth = 256;
     static constexpr int nesHeight = 240;
-    std::array<uint8_t, nesWidth * nesHeight * 3> pixels;
+    //Bottom line first, the way glDrawPixels reads them
+    std::array<uint32_t, nesWidth * nesHeight> pixels;
+
+    PerfCounters* perfCounters;
 };
 
 #endif
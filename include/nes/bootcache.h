@@ -0,0 +1,34 @@
+#ifndef BOOTCACHE_H
+#define BOOTCACHE_H
+
+#include "cpu.h"
+#include "rombuffer.h"
+#include "span.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Snapshots of machines taken after power-on and a few warmup frames, one file per ROM
+//contents, CPU tier and warmup length in a local directory. Nes::loadCartridge resumes from
+//them instead of replaying the boot. Disabled until a directory is set. Thread safe.
+class BootCache
+{
+public:
+    //An empty directory disables the cache, the default
+    static void setDirectory(const std::string& directory);
+    static std::string getDirectory();
+    static bool isEnabled();
+
+    //Frames run after power-on before the snapshot is taken, 60 by default
+    static void setWarmupFrames(unsigned int frames);
+    static unsigned int getWarmupFrames();
+
+    //Maps the snapshot for the ROM, nullptr if there is none yet
+    static std::shared_ptr<const RomBuffer> load(ByteSpan rom, CpuAccuracy accuracy);
+    //Written to a temporary file then renamed, other instances never see half a snapshot
+    static bool store(ByteSpan rom, CpuAccuracy accuracy, const std::vector<uint8_t>& snapshot);
+};
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef BUSACCESS_H
+#define BUSACCESS_H
+
+#include <cstdint>
+
+//Why the CPU is touching the bus. Values are bit flags so they can be OR'ed into coverage maps.
+enum class BusAccess : uint8_t
+{
+    OPCODE = 0x01,
+    OPERAND = 0x02,
+    DATA = 0x04,
+    DUMMY = 0x08
+};
+
+#endif
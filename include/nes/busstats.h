@@ -0,0 +1,78 @@
+#ifndef BUSSTATS_H
+#define BUSSTATS_H
+
+#include "busaccess.h"
+
+#include <cstdint>
+#include <array>
+#include <ostream>
+
+enum class BusRegion { RAM, PPU, APU_IO, CARTRIDGE, COUNT };
+
+//Access counters kept by CpuBus when built with CRNES_BUS_STATS.
+//Totals are split by region and access kind, the page heatmap is reset every frame. The FAST CPU
+//tier fetches opcodes and operands around them, only ACCURATE counts every access.
+class BusStats
+{
+public:
+    static constexpr int nbRegions = static_cast<int>(BusRegion::COUNT);
+    static constexpr int nbKinds = 4;
+
+    BusStats();
+
+    void recordRead(uint16_t addr, BusAccess access)
+    {
+        ++reads[regionIndex(addr)][kindIndex(access)];
+        ++pageReads[addr >> 8];
+    }
+
+    void recordWrite(uint16_t addr)
+    {
+        ++writes[regionIndex(addr)];
+        ++pageWrites[addr >> 8];
+    }
+
+    void setHeatmapOutput(std::ostream* os) { heatmapOutput = os; }
+    void endFrame();
+
+    void clear();
+    void writeSummary(std::ostream& os) const;
+
+private:
+    static int regionIndex(uint16_t addr)
+    {
+        if (addr < 0x2000) {
+            return static_cast<int>(BusRegion::RAM);
+        } else if (addr < 0x4000) {
+            return static_cast<int>(BusRegion::PPU);
+        } else if (addr < 0x4020) {
+            return static_cast<int>(BusRegion::APU_IO);
+        }
+        return static_cast<int>(BusRegion::CARTRIDGE);
+    }
+
+    static int kindIndex(BusAccess access)
+    {
+        switch (access) {
+        case BusAccess::OPCODE:
+            return 0;
+        case BusAccess::OPERAND:
+            return 1;
+        case BusAccess::DATA:
+            return 2;
+        default:
+            return 3;
+        }
+    }
+
+    std::array<std::array<uint64_t, nbKinds>, nbRegions> reads;
+    std::array<uint64_t, nbRegions> writes;
+
+    std::array<uint32_t, 0x100> pageReads;
+    std::array<uint32_t, 0x100> pageWrites;
+
+    std::ostream* heatmapOutput;
+    uint64_t frameCount;
+};
+
+#endif
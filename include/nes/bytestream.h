@@ -0,0 +1,73 @@
+#ifndef BYTESTREAM_H
+#define BYTESTREAM_H
+
+#include "span.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+//Little endian integers and raw bytes, for the files the emulator writes itself
+
+class ByteWriter
+{
+public:
+    std::vector<uint8_t> data;
+
+    void put(uint64_t value, int nbBytes)
+    {
+        for (int i = 0; i < nbBytes; ++i) {
+            data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void putBytes(const void* bytes, size_t size)
+    {
+        size_t offset = data.size();
+        data.resize(offset + size);
+        std::memcpy(data.data() + offset, bytes, size);
+    }
+};
+
+//Reading past the end returns zeros and clears isOk, so callers check once at the end
+class ByteReader
+{
+public:
+    ByteReader(ByteSpan data) : data(data), pos(0), ok(true) {}
+
+    uint64_t get(int nbBytes)
+    {
+        if (pos + nbBytes > data.size()) {
+            ok = false;
+            return 0;
+        }
+
+        uint64_t value = 0;
+        for (int i = 0; i < nbBytes; ++i) {
+            value |= static_cast<uint64_t>(data[pos++]) << (i * 8);
+        }
+        return value;
+    }
+
+    void getBytes(void* bytes, size_t size)
+    {
+        if (pos + size > data.size()) {
+            ok = false;
+            return;
+        }
+        std::copy(data.begin() + pos, data.begin() + pos + size, static_cast<uint8_t*>(bytes));
+        pos += size;
+    }
+
+    bool isOk() const { return ok; }
+    bool atEnd() const { return pos == data.size(); }
+
+private:
+    ByteSpan data;
+    size_t pos;
+    bool ok;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef CHRTILECACHE_H
+#define CHRTILECACHE_H
+
+#include <array>
+#include <cstdint>
+
+class PpuBus;
+
+//The 512 tiles of the $0000-$1FFF pattern space as the mapper currently maps it, decoded from
+//their two bitplanes into one color index (0 to 3) per pixel. A tile is decoded the first time
+//it's drawn after an invalidation, the PPU bus invalidates tiles when CHR-RAM is written or a
+//bank is switched.
+class ChrTileCache
+{
+public:
+    static constexpr unsigned int nbTiles = 512;
+
+    ChrTileCache(const PpuBus* bus);
+    //Decodes from an 8KB copy of the pattern space instead of the bus
+    ChrTileCache(const uint8_t* patterns);
+
+    //8 pixels, row 0 is the top of the tile
+    const uint8_t* getRow(unsigned int tile, unsigned int row)
+    {
+        if (!valid[tile]) {
+            decode(tile);
+        }
+        return tiles[tile].data() + row * 8;
+    }
+    //The row's non-zero pixels, bit 7 is the leftmost
+    uint8_t getOpaqueMask(unsigned int tile, unsigned int row)
+    {
+        if (!valid[tile]) {
+            decode(tile);
+        }
+        return opaqueMasks[tile][row];
+    }
+
+    //addr is a pattern space address, every tile overlapping the range is decoded again
+    void invalidate(uint16_t addr) { valid[(addr >> 4) & (nbTiles - 1)] = false; }
+    void invalidate(uint16_t addr, uint16_t size);
+    void invalidateAll() { valid.fill(false); }
+    //Decodes every invalid tile, getRow is then safe to call from several threads
+    void decodeAll();
+
+    uint64_t getNbDecoded() const { return nbDecoded; }
+
+private:
+    void decode(unsigned int tile);
+
+    const PpuBus* bus;
+    const uint8_t* patterns;
+
+    std::array<std::array<uint8_t, 64>, nbTiles> tiles;
+    std::array<std::array<uint8_t, 8>, nbTiles> opaqueMasks;
+    std::array<bool, nbTiles> valid;
+    uint64_t nbDecoded;
+};
+
+#endif
@@ -2,42 +2,165 @@
 #define CPU_H
 
 #include <cstdint>
-#include <array>
+#include <memory>
+#include <string>
 
 #include "bitfield.h"
 #include "cpubus.h"
 #include "cpulogger.h"
-#include "opdef.h"
+#include "cpuprofiler.h"
+#include "optable.h"
 
-class Cpu
-{
-public:
-    Cpu();
+class ByteReader;
+class ByteWriter;
 
-    void tick();
-    void setMediator(CpuBus* mediator) { this->bus = mediator; }
-
-private:
-    //Registers
+struct CpuRegisters
+{
     uint16_t PC;
     uint8_t A;
     uint8_t X;
     uint8_t Y;
     uint8_t S;
-    Bitfield P;
+    uint8_t P;
+};
+
+//A register access sees the bus cycle count, the PPU catches up to it and $4014 takes its parity.
+//ACCURATE does every bus access, including dummy reads, and ticks the bus at each cycle() the
+//instruction accounts. Accesses aren't issued in step with those : the opcode fetch's cycle is
+//counted at the end and most addressing modes count theirs before or after their reads, so an
+//access sees the count from a few cycles before to a few after the one it happens in.
+//FAST skips dummy reads and the operand reads only the logger uses, and fetches opcodes and
+//operands straight from RAM or the cartridge. It counts an opcode's cycles from a table and hands
+//them to the bus when the instruction finishes, every access sees the count from the start of the
+//instruction. $2002 polling, NMI at vblank and the $4014 parity can land up to one instruction
+//away from ACCURATE. Fetches don't reach the bus statistics or the coverage map, those need ACCURATE.
+enum class CpuAccuracy { FAST, ACCURATE };
+
+const char* cpuAccuracyName(CpuAccuracy accuracy);
+
+//Registers and public interface. The interpreter is CpuCore, instantiated per accuracy tier and bus type.
+class Cpu
+{
+public:
+    virtual ~Cpu();
+
+    virtual CpuAccuracy getAccuracy() const = 0;
+
+    //Executes one whole instruction
+    virtual void tick() = 0;
+    //Runs whole instructions until the bus cycle count reaches deadline or the next event
+    virtual void run(uint64_t deadline) = 0;
+    void setNextEvent(uint64_t cycle) { state.nextEvent = cycle; }
+
+    void reset() { state.resetSignal = true; }
+    //Taken before the next instruction
+    void nmi() { state.nmiSignal = true; }
+    void setProfiler(CpuProfiler* profiler) { state.profiler = profiler; }
+
+    uint64_t getInstructionCount() const { return state.instructionCount; }
+
+    CpuRegisters getRegisters() const { return {state.PC, state.A, state.X, state.Y, state.S, state.P.raw}; }
+    //Also cancels a pending reset
+    void setRegisters(const CpuRegisters& registers);
+
+    //Registers and counters. The bus, logger and profiler stay as they are.
+    void saveState(ByteWriter& writer) const;
+    void loadState(ByteReader& reader);
+
+protected:
+    //An empty filename disables the log
+    Cpu(const std::string& logFilename);
+
+    //Everything an instruction touches, kept in one cache line
+    struct alignas(64) State
+    {
+        //Always the Bus type CpuCore was instantiated with
+        CpuBus* bus;
+        CpuProfiler* profiler;
+        CpuLogger* logger;
+
+        uint64_t instructionCount;
+        //Bus cycle at which run() returns
+        uint64_t nextEvent;
+
+        uint16_t PC;
+        uint8_t A;
+        uint8_t X;
+        uint8_t Y;
+        uint8_t S;
+        Bitfield P;
+        bool resetSignal;
+        bool nmiSignal;
+
+        //Penalty cycles not yet handed to the bus, FAST tier only
+        uint32_t pendingCycles;
+    };
+
+    static_assert(sizeof(State) == 64, "Cpu::State should fit in one cache line");
+
+    State state;
+
+    //Cold data, only allocated when logging
+    std::unique_ptr<CpuLogger> loggerStorage;
+};
+
+//Bus is the concrete bus class, usually a MappedCpuBus, so every access is a direct call.
+//The member definitions are in cpucore.h, include it where a new instantiation is needed.
+template<CpuAccuracy accuracy, class Bus>
+class CpuCore final : public Cpu
+{
+public:
+    CpuCore(Bus* bus, const std::string& logFilename = "cpu_log.txt") : Cpu(logFilename) { state.bus = bus; }
+
+    CpuAccuracy getAccuracy() const override { return accuracy; }
+
+    void tick() override;
+    void run(uint64_t deadline) override;
+
+private:
+    Bus* bus() const { return static_cast<Bus*>(state.bus); }
 
-    unsigned int cycleCount;
-    bool resetSignal;
+    //ACCURATE ticks the bus at every cycle. FAST counts the cycles an opcode always takes up front,
+    //from countedCycles, and only the page crossing and branch penalties as they happen.
+    void cycle()
+    {
+        if constexpr (accuracy == CpuAccuracy::ACCURATE) {
+            bus()->tick();
+        }
+    }
 
-    CpuBus* bus;
+    void penaltyCycle()
+    {
+        if constexpr (accuracy == CpuAccuracy::ACCURATE) {
+            bus()->tick();
+        } else {
+            ++state.pendingCycles;
+        }
+    }
 
-    std::array<Opcode, 0x100> opcodes;
+    //Opcode and operand bytes
+    uint8_t fetch(uint16_t addr, BusAccess access)
+    {
+        if constexpr (accuracy == CpuAccuracy::ACCURATE) {
+            return bus()->read(addr, access);
+        } else {
+            return bus()->fetch(addr);
+        }
+    }
 
-    CpuLogger logger;
+    //cycles is what FAST counts up front for the instruction
+    void flushCycles(unsigned int cycles)
+    {
+        if constexpr (accuracy == CpuAccuracy::FAST) {
+            bus()->tick(cycles + state.pendingCycles);
+            state.pendingCycles = 0;
+        }
+    }
 
-    void executeOp(uint16_t addr, Opcode opcode);
+    //NMI and IRQ sequence, 7 cycles
+    void interrupt(uint16_t vector);
+    void executeOp(uint16_t addr, const Opcode& opcode);
     uint16_t getAddress(AddrMode addrMode);
-    void generateOpcodes();
     void branchIf(uint16_t offsetAddr, bool condition);
 
 
@@ -1,25 +1,150 @@
 #ifndef NESMEDIATOR_H
 #define NESMEDIATOR_H
 
-#include "imemory.h"
 #include "cpuram.h"
 #include "cartridgemapper.h"
+#include "busaccess.h"
+#include "ppu.h"
 
-class Cpu;
+#include <cassert>
 
-class CpuBus : public IMemory
+class ByteReader;
+class ByteWriter;
+
+#ifdef CRNES_BUS_STATS
+#include "busstats.h"
+#endif
+
+//What every bus has regardless of the cartridge : the cycle counter and the access statistics.
+//The address decoding is in MappedCpuBus.
+class CpuBus
 {
 public:
-    CpuBus(CpuRam* cpuRam = nullptr, CartridgeMapper* cartridge = nullptr);
+    CpuBus(CpuRam* cpuRam);
 
-    virtual uint8_t read(uint16_t addr) override;
-    virtual void write(uint16_t addr, uint8_t data) override;
+    void tick()
+    {
+        //Called when the CPU has finished a cycle so we can tick
+        //the APU and PPU the necessary number of times
+        ++cycleCount;
+    }
 
-    void tick();
-    void setCartridge(CartridgeMapper* cartridge) { this->cartridge = cartridge; }
-private:
+    void tick(unsigned int nbCycles)
+    {
+        //Several cycles at once, from the FAST CPU tier at the end of each instruction
+        cycleCount += nbCycles;
+    }
+
+    uint64_t getCycleCount() const { return cycleCount; }
+
+    //Without a PPU its registers read as 0 and ignore writes
+    void setPpu(Ppu* ppu) { this->ppu = ppu; }
+
+    //The cycle counter, the statistics aren't part of the machine state
+    void saveState(ByteWriter& writer) const;
+    void loadState(ByteReader& reader);
+
+#ifdef CRNES_BUS_STATS
+    BusStats& getStats() { return stats; }
+    void endFrame() { stats.endFrame(); }
+#else
+    void endFrame() {}
+#endif
+protected:
     CpuRam* cpuRam;
-    CartridgeMapper* cartridge;
+    Ppu* ppu;
+
+    uint64_t cycleCount;
+
+#ifdef CRNES_BUS_STATS
+    BusStats stats;
+#endif
+};
+
+//Mapper is the concrete cartridge type. With a final mapper the reads and writes are direct
+//calls the compiler can inline, MappedCpuBus<CartridgeMapper> goes through the vtable.
+template<class Mapper>
+class MappedCpuBus : public CpuBus
+{
+public:
+    MappedCpuBus(CpuRam* cpuRam = nullptr, Mapper* cartridge = nullptr) : CpuBus(cpuRam), cartridge(cartridge) {}
+
+    uint8_t read(uint16_t addr, BusAccess access = BusAccess::DATA);
+    void write(uint16_t addr, uint8_t data);
+
+    //Opcode and operand fetches of the FAST CPU tier. RAM and cartridge space are read directly,
+    //without the statistics or the coverage map.
+    uint8_t fetch(uint16_t addr)
+    {
+        if (addr < 0x2000) {
+            return cpuRam->read(addr & 0x07FF);
+        } else if (addr >= 0x6000) {
+            return cartridge->peekCpuBus(addr);
+        }
+        return read(addr, BusAccess::OPERAND);
+    }
+
+    void setCartridge(Mapper* cartridge) { this->cartridge = cartridge; }
+
+private:
+    Mapper* cartridge;
 };
 
+template<class Mapper>
+uint8_t MappedCpuBus<Mapper>::read(uint16_t addr, BusAccess access)
+{
+    assert(cpuRam);
+    assert(cartridge);
+
+#ifdef CRNES_BUS_STATS
+    stats.recordRead(addr, access);
+#endif
+
+    if (addr < 0x2000) { //CPU RAM locations
+        return cpuRam->read(addr & 0x07FF);
+    } else if (addr < 0x4000) { //PPU registers, mirrored every 8 bytes
+        if (!ppu) {
+            return 0;
+        }
+        ppu->catchUp(cycleCount);
+        return ppu->readRegister(addr);
+    } else if (addr < 0x4020) { //APU registers and controller registers
+        return 0;
+    } else {
+        return cartridge->readCpuBus(addr, access);
+    }
+}
+
+template<class Mapper>
+void MappedCpuBus<Mapper>::write(uint16_t addr, uint8_t data)
+{
+    assert(cpuRam);
+    assert(cartridge);
+
+#ifdef CRNES_BUS_STATS
+    stats.recordWrite(addr);
+#endif
+
+    if (addr < 0x2000) { //CPU RAM locations
+        return cpuRam->write(addr & 0x07FF, data);
+    } else if (addr < 0x4000) { //PPU registers, mirrored every 8 bytes
+        if (ppu) {
+            ppu->catchUp(cycleCount);
+            ppu->writeRegister(addr, data);
+        }
+    } else if (addr == 0x4014) { //OAM DMA, the CPU is halted while the page is copied
+        if (ppu) {
+            ppu->catchUp(cycleCount);
+            for (unsigned int i = 0; i < 0x100; ++i) {
+                ppu->writeOamDma(read((data << 8) | i));
+            }
+            tick(513 + (cycleCount & 1));
+        }
+    } else if (addr < 0x4020) { //APU registers and controller registers
+
+    } else {
+        cartridge->writeCpuBus(addr, data);
+    }
+}
+
 #endif
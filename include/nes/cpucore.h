@@ -0,0 +1,1246 @@
+#ifndef CPUCORE_H
+#define CPUCORE_H
+
+#include "cpu.h"
+
+#include <array>
+#include <iostream>
+#include <cassert>
+
+namespace cpucore_detail
+{
+//cycle() calls of each addressing mode and operation below, without the page crossing and
+//branch penalties. Keep them in step with the functions.
+constexpr uint8_t addrModeCycles(AddrMode addrMode)
+{
+    switch (addrMode) {
+    case AddrMode::ZERO_PAGE_X:
+    case AddrMode::ZERO_PAGE_Y:
+    case AddrMode::ABSOLUTE:
+    case AddrMode::ABSOLUTE_X:
+    case AddrMode::ABSOLUTE_Y:
+        return 2;
+    case AddrMode::INDIRECT_INDEXED:
+        return 3;
+    case AddrMode::INDIRECT:
+    case AddrMode::INDEXED_INDIRECT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+constexpr uint8_t opCycles(Op op, AddrMode addrMode)
+{
+    switch (op) {
+    case Op::BIT:
+    case Op::CMP:
+    case Op::CPX:
+    case Op::CPY:
+    case Op::EOR:
+    case Op::JMP:
+    case Op::LDA:
+    case Op::LDX:
+    case Op::LDY:
+    case Op::ORA:
+    case Op::SBC:
+        return 0;
+    case Op::ASL:
+        return addrMode == AddrMode::ACCUMULATOR ? 0 : 1;
+    case Op::LSR:
+    case Op::ROL:
+    case Op::ROR:
+        return addrMode == AddrMode::ACCUMULATOR ? 1 : 2;
+    case Op::INC:
+    case Op::PHA:
+    case Op::PHP:
+        return 2;
+    case Op::JSR:
+    case Op::PLA:
+    case Op::PLP:
+        return 3;
+    case Op::RTI:
+    case Op::RTS:
+        return 5;
+    case Op::BRK:
+        return 6;
+    default: //Branches count their not taken cycle here
+        return 1;
+    }
+}
+
+constexpr std::array<uint8_t, 0x100> makeCountedCycles()
+{
+    std::array<uint8_t, 0x100> table {};
+
+    for (unsigned int i = 0; i < table.size(); ++i) {
+        //And the one at the end of every instruction
+        table[i] = addrModeCycles(opTable[i].addrMode) + opCycles(opTable[i].op, opTable[i].addrMode) + 1;
+    }
+
+    return table;
+}
+}
+
+//Cycles the FAST tier counts for an opcode before running it
+inline constexpr std::array<uint8_t, 0x100> countedCycles = cpucore_detail::makeCountedCycles();
+
+template<class Bus>
+std::unique_ptr<Cpu> createCpu(CpuAccuracy accuracy, Bus* bus, const std::string& logFilename = "cpu_log.txt")
+{
+    if (accuracy == CpuAccuracy::FAST) {
+        return std::make_unique<CpuCore<CpuAccuracy::FAST, Bus>>(bus, logFilename);
+    }
+    return std::make_unique<CpuCore<CpuAccuracy::ACCURATE, Bus>>(bus, logFilename);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::run(uint64_t deadline)
+{
+    state.nextEvent = deadline;
+
+    while (bus()->getCycleCount() < state.nextEvent) {
+        tick();
+    }
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::tick()
+{
+    if (state.resetSignal) {
+        state.resetSignal = false;
+
+        //TODO: Reset PPU
+
+        state.PC = bus()->read(0xFFFC) | (bus()->read(0xFFFD) << 8);
+
+        cycle();
+        cycle();
+        cycle();
+        cycle();
+        cycle();
+        cycle();
+        flushCycles(6);
+
+        if (state.profiler) {
+            state.profiler->onReset(state.PC, bus()->getCycleCount());
+        }
+
+        return;
+    }
+
+    if (state.nmiSignal) {
+        state.nmiSignal = false;
+        interrupt(0xFFFA);
+        return;
+    }
+
+    uint16_t opPC = state.PC;
+    uint64_t startCycle = bus()->getCycleCount();
+
+    uint8_t opId = fetch(state.PC++, BusAccess::OPCODE);
+    const Opcode& opcode = opTable[opId];
+
+    if (state.logger) {
+        state.logger->setPC(opPC);
+        state.logger->addMemLocation(opId);
+        state.logger->setOpcode(opcode);
+        state.logger->setRegisters(state.A, state.X, state.Y, state.S, state.P);
+    }
+
+    uint16_t addr = getAddress(opcode.addrMode);
+    executeOp(addr, opcode);
+
+    if (state.logger) {
+        state.logger->finishInstruction();
+    }
+    ++state.instructionCount;
+
+    cycle();
+    flushCycles(countedCycles[opId]);
+
+    if (state.profiler) {
+        state.profiler->onInstruction(opPC, opId, opcode, startCycle, bus()->getCycleCount(), state.PC);
+    }
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::interrupt(uint16_t vector)
+{
+    uint16_t interruptedPC = state.PC;
+
+    //Two dummy reads of the next opcode, then the pushes and the vector fetch like BRK
+    if constexpr (accuracy == CpuAccuracy::ACCURATE) {
+        bus()->read(state.PC, BusAccess::DUMMY); //Dummy read
+    }
+    cycle();
+    if constexpr (accuracy == CpuAccuracy::ACCURATE) {
+        bus()->read(state.PC, BusAccess::DUMMY); //Dummy read
+    }
+    cycle();
+
+    bus()->write(0x100 + state.S--, state.PC >> 8);
+    bus()->write(0x100 + state.S--, state.PC);
+    bus()->write(0x100 + state.S--, (state.P.raw & 0xEF) | 0x20);
+    cycle();
+    cycle();
+    cycle();
+
+    state.P.I = true;
+    state.PC = bus()->read(vector) | (bus()->read(vector + 1) << 8);
+    cycle();
+    cycle();
+    flushCycles(7);
+
+    if (state.profiler) {
+        state.profiler->onInterrupt(interruptedPC, state.PC);
+    }
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::executeOp(uint16_t addr, const Opcode& opcode)
+{
+    switch (opcode.op) {
+    case Op::ADC:
+        ADC(addr);
+        break;
+    case Op::AND:
+        AND(addr);
+        break;
+    case Op::ASL:
+        ASL(addr, opcode.addrMode);
+        break;
+    case Op::BCC:
+        BCC(addr);
+        break;
+    case Op::BCS:
+        BCS(addr);
+        break;
+    case Op::BEQ:
+        BEQ(addr);
+        break;
+    case Op::BIT:
+        BIT(addr);
+        break;
+    case Op::BMI:
+        BMI(addr);
+        break;
+    case Op::BNE:
+        BNE(addr);
+        break;
+    case Op::BPL:
+        BPL(addr);
+        break;
+    case Op::BRK:
+        BRK(addr);
+        break;
+    case Op::BVC:
+        BVC(addr);
+        break;
+    case Op::BVS:
+        BVS(addr);
+        break;
+    case Op::CLC:
+        CLC(addr);
+        break;
+    case Op::CLD:
+        CLD(addr);
+        break;
+    case Op::CLI:
+        CLI(addr);
+        break;
+    case Op::CLV:
+        CLV(addr);
+        break;
+    case Op::CMP:
+        CMP(addr);
+        break;
+    case Op::CPX:
+        CPX(addr);
+        break;
+    case Op::CPY:
+        CPY(addr);
+        break;
+    case Op::DEC:
+        DEC(addr);
+        break;
+    case Op::DEX:
+        DEX();
+        break;
+    case Op::DEY:
+        DEY();
+        break;
+    case Op::EOR:
+        EOR(addr);
+        break;
+    case Op::INC:
+        INC(addr);
+        break;
+    case Op::INX:
+        INX();
+        break;
+    case Op::INY:
+        INY();
+        break;
+    case Op::JMP:
+        JMP(addr);
+        break;
+    case Op::JSR:
+        JSR(addr);
+        break;
+    case Op::LDA:
+        LDA(addr);
+        break;
+    case Op::LDX:
+        LDX(addr);
+        break;
+    case Op::LDY:
+        LDY(addr);
+        break;
+    case Op::LSR:
+        LSR(addr, opcode.addrMode);
+        break;
+    case Op::NOP:
+        NOP(addr);
+        break;
+    case Op::ORA:
+        ORA(addr);
+        break;
+    case Op::PHA:
+        PHA();
+        break;
+    case Op::PHP:
+        PHP();
+        break;
+    case Op::PLA:
+        PLA();
+        break;
+    case Op::PLP:
+        PLP();
+        break;
+    case Op::ROL:
+        ROL(addr, opcode.addrMode);
+        break;
+    case Op::ROR:
+        ROR(addr, opcode.addrMode);
+        break;
+    case Op::RTI:
+        RTI();
+        break;
+    case Op::RTS:
+        RTS();
+        break;
+    case Op::SBC:
+        SBC(addr);
+        break;
+    case Op::SEC:
+        SEC();
+        break;
+    case Op::SED:
+        SED();
+        break;
+    case Op::SEI:
+        SEI();
+        break;
+    case Op::STA:
+        STA(addr);
+        break;
+    case Op::STX:
+        STX(addr);
+        break;
+    case Op::STY:
+        STY(addr);
+        break;
+    case Op::TAX:
+        TAX();
+        break;
+    case Op::TAY:
+        TAY();
+        break;
+    case Op::TSX:
+        TSX();
+        break;
+    case Op::TXA:
+        TXA();
+        break;
+    case Op::TXS:
+        TXS();
+        break;
+    case Op::TYA:
+        TYA();
+        break;
+    default:
+        std::cout << "Bad opcode enum : " << static_cast<int>(opcode.op) << std::endl;
+        assert(false);
+        break;
+    }
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::getAddress(AddrMode addrMode)
+{
+    uint16_t addr = 0x00;
+
+    switch (addrMode) {
+    case AddrMode::IMPLICIT:
+        addr = implicitAM();
+        break;
+    case AddrMode::ACCUMULATOR:
+        addr = accumulatorAM();
+        break;
+    case AddrMode::IMMEDIATE:
+        addr = immediateAM();
+        break;
+    case AddrMode::ZERO_PAGE:
+        addr = zeroPageAM();
+        break;
+    case AddrMode::ZERO_PAGE_X:
+        addr = zeroPageXAM();
+        break;
+    case AddrMode::ZERO_PAGE_Y:
+        addr = zeroPageYAM();
+        break;
+    case AddrMode::RELATIVE:
+        addr = relativeAM();
+        break;
+    case AddrMode::ABSOLUTE:
+        addr = absoluteAM();
+        break;
+    case AddrMode::ABSOLUTE_X:
+        addr = absoluteXAM();
+        break;
+    case AddrMode::ABSOLUTE_Y:
+        addr = absoluteYAM();
+        break;
+    case AddrMode::INDIRECT:
+        addr = indirectAM();
+        break;
+    case AddrMode::INDEXED_INDIRECT:
+        addr = indexedIndirectAM();
+        break;
+    case AddrMode::INDIRECT_INDEXED:
+        addr = indirectIndexedAM();
+        break;
+    default:
+        std::cout << "Bad Addressing Mode!" << std::endl;
+        assert(false);
+        break;
+    }
+
+    return addr;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::branchIf(uint16_t offsetAddr, bool condition)
+{
+    if (condition) {
+        uint8_t data = fetch(offsetAddr, BusAccess::OPERAND);
+        uint8_t PCL = static_cast<uint8_t>(state.PC);
+        uint8_t result = PCL + data;
+
+        state.PC += static_cast<int8_t>(data); //Offset is SIGNED
+
+        if (!(((PCL & 0x80) ^ (data & 0x80)) || ((PCL & 0x80) == (result & 0x80)))) {
+            penaltyCycle();
+        }
+        cycle();
+        penaltyCycle();
+    } else {
+        cycle();
+    }
+}
+
+
+//TODO : Check timing
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::implicitAM() const
+{
+    return 0;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::accumulatorAM() const
+{
+    return 0;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::immediateAM()
+{
+    //TODO : This is no good. I don't think the call to read() could be optimized away by an empty
+    //version of the logger. There shouldn't be any side effects from the read as PC should be in ROM.
+    if (accuracy == CpuAccuracy::ACCURATE || state.logger) {
+        uint8_t operand = fetch(state.PC, BusAccess::OPERAND);
+        if (state.logger) {
+            state.logger->addMemLocation(operand);
+        }
+    }
+    return state.PC++;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::zeroPageAM()
+{
+    uint8_t addr = fetch(state.PC++, BusAccess::OPERAND);
+    if (state.logger) {
+        state.logger->addMemLocation(addr);
+    }
+    return addr;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::zeroPageXAM()
+{
+    cycle();
+    cycle();
+    uint8_t mem = fetch(state.PC++, BusAccess::OPERAND);
+    if (state.logger) {
+        state.logger->addMemLocation(mem);
+    }
+    return static_cast<uint8_t>(mem + state.X);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::zeroPageYAM()
+{
+    cycle();
+    cycle();
+    uint8_t mem = fetch(state.PC++, BusAccess::OPERAND);
+    if (state.logger) {
+        state.logger->addMemLocation(mem);
+    }
+    return static_cast<uint8_t>(mem + state.Y);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::relativeAM()
+{
+    //TODO : This is no good. I don't think the call to read() could be optimized away by an empty
+    //version of the logger. There shouldn't be any side effects from the read as PC should be in ROM.
+    if (accuracy == CpuAccuracy::ACCURATE || state.logger) {
+        uint8_t operand = fetch(state.PC, BusAccess::OPERAND);
+        if (state.logger) {
+            state.logger->addMemLocation(operand);
+        }
+    }
+    return state.PC++;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::absoluteAM()
+{
+    cycle();
+    cycle();
+
+    uint8_t low = fetch(state.PC++, BusAccess::OPERAND);
+    uint8_t high = fetch(state.PC++, BusAccess::OPERAND);
+
+    if (state.logger) {
+        state.logger->addMemLocation(low);
+        state.logger->addMemLocation(high);
+    }
+
+    return low | (high << 8);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::absoluteXAM()
+{
+    uint8_t low = fetch(state.PC++, BusAccess::OPERAND);
+    uint8_t high = fetch(state.PC++, BusAccess::OPERAND);
+    uint16_t addr = low | (high << 8);
+
+
+    if (state.logger) {
+        state.logger->addMemLocation(low);
+        state.logger->addMemLocation(high);
+    }
+
+    cycle();
+    cycle();
+    if ((addr & 0x00FF) + state.X > 0xFF) {
+        if constexpr (accuracy == CpuAccuracy::ACCURATE) {
+            bus()->read(addr + state.X - 0x100, BusAccess::DUMMY); //Dummy read
+        }
+        penaltyCycle();
+    }
+
+    return addr + state.X;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::absoluteYAM()
+{
+    uint8_t low = fetch(state.PC++, BusAccess::OPERAND);
+    uint8_t high = fetch(state.PC++, BusAccess::OPERAND);
+    uint16_t addr = low | (high << 8);
+
+
+    if (state.logger) {
+        state.logger->addMemLocation(low);
+        state.logger->addMemLocation(high);
+    }
+
+    cycle();
+    cycle();
+    if ((addr & 0x00FF) + state.Y > 0xFF) {
+        if constexpr (accuracy == CpuAccuracy::ACCURATE) {
+            bus()->read(addr + state.Y - 0x100, BusAccess::DUMMY); //Dummy read
+        }
+        penaltyCycle();
+    }
+
+    return addr + state.Y;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::indirectAM()
+{
+    uint8_t low = fetch(state.PC++, BusAccess::OPERAND);
+    uint8_t high = fetch(state.PC++, BusAccess::OPERAND);
+    uint8_t addrLow = bus()->read(low | (high << 8));
+    uint8_t addrHigh = bus()->read(static_cast<uint8_t>(low + 1) | (high << 8)); //page wrapping
+
+    if (state.logger) {
+        state.logger->addMemLocation(low);
+        state.logger->addMemLocation(high);
+    }
+
+    cycle();
+    cycle();
+    cycle();
+    cycle();
+
+    return addrLow | (addrHigh << 8);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::indexedIndirectAM()
+{
+    cycle();
+    cycle();
+    cycle();
+    cycle();
+
+    uint8_t offset = fetch(state.PC++, BusAccess::OPERAND);
+    uint8_t base = offset + state.X;
+
+    if (state.logger) {
+        state.logger->addMemLocation(offset);
+    }
+
+    return bus()->read(base) | (bus()->read(static_cast<uint8_t>(base + 1)) << 8); //page wrapping
+}
+
+template<CpuAccuracy accuracy, class Bus>
+uint16_t CpuCore<accuracy, Bus>::indirectIndexedAM()
+{
+    uint8_t base = fetch(state.PC++, BusAccess::OPERAND);
+    uint16_t addr = bus()->read(base) | (bus()->read(static_cast<uint8_t>(base + 1)) << 8); //page wrapping
+
+    if (state.logger) {
+        state.logger->addMemLocation(base);
+    }
+
+    cycle();
+    cycle();
+    cycle();
+    if ((addr & 0x00FF) + state.Y > 0xFF) {
+        if constexpr (accuracy == CpuAccuracy::ACCURATE) {
+            bus()->read(addr + state.Y - 0x100, BusAccess::DUMMY); //Dummy read
+        }
+        penaltyCycle();
+    }
+
+    return addr + state.Y;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::ADC(uint16_t addr)
+{
+    uint8_t d = bus()->read(addr);
+    uint16_t result = state.A + d + (state.P.C ? 1 : 0);
+
+    state.P.C = result > 0xFF;
+
+    bool a = state.A & 0x80;
+    bool b = (d + (state.P.C ? 1 : 0)) & 0x80;
+    bool r = result & 0x80;
+    state.P.V = (r & !(a | b)) | (!r & a & b);
+
+    state.A = static_cast<uint8_t>(result);
+
+    state.P.Z = state.A == 0;
+    state.P.N = state.A & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::AND(uint16_t addr)
+{
+    state.A &= bus()->read(addr);
+
+    state.P.Z = state.A == 0;
+    state.P.N = state.A & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::ASL(uint16_t addr, AddrMode addrMode)
+{
+    uint8_t data = addrMode == AddrMode::ACCUMULATOR ? state.A : bus()->read(addr);
+    uint8_t result = data << 1;
+
+    state.P.C = data & 0x80;
+    state.P.Z = result == 0;
+    state.P.N = result & 0x80;
+
+    if (addrMode == AddrMode::ACCUMULATOR) {
+        state.A = result;
+    } else {
+        bus()->write(addr, result);
+        cycle();
+    }
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::BCC(uint16_t addr)
+{
+    branchIf(addr, !state.P.C);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::BCS(uint16_t addr)
+{
+    branchIf(addr, state.P.C);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::BEQ(uint16_t addr)
+{
+    branchIf(addr, state.P.Z);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::BIT(uint16_t addr)
+{
+    uint8_t mem = bus()->read(addr);
+    uint8_t result = state.A & mem;
+
+    state.P.Z = result == 0;
+    state.P.V = mem & 0x40;
+    state.P.N = mem & 0x80;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::BMI(uint16_t addr)
+{
+    branchIf(addr, state.P.N);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::BNE(uint16_t addr)
+{
+    branchIf(addr, !state.P.Z);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::BPL(uint16_t addr)
+{
+    branchIf(addr, !state.P.N);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::BRK(uint16_t addr)
+{
+    ++state.PC;
+
+    bus()->write(0x100 + state.S--, state.PC >> 8);
+    bus()->write(0x100 + state.S--, state.PC);
+    bus()->write(0x100 + state.S--, state.P.raw | 0x30);
+
+    state.P.B = true;
+
+    state.PC = bus()->read(0xFFFE) | (bus()->read(0xFFFF) << 8);
+
+    cycle();
+    cycle();
+    cycle();
+    cycle();
+    cycle();
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::BVC(uint16_t addr)
+{
+    branchIf(addr, !state.P.V);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::BVS(uint16_t addr)
+{
+    branchIf(addr, state.P.V);
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::CLC(uint16_t addr)
+{
+    state.P.C = false;
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::CLD(uint16_t addr)
+{
+    state.P.D = false;
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::CLI(uint16_t addr)
+{
+    state.P.I = false;
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::CLV(uint16_t addr)
+{
+    state.P.V = false;
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::CMP(uint16_t addr)
+{
+    uint8_t data = bus()->read(addr);
+    uint8_t result = state.A - data;
+
+    state.P.C = state.A >= data;
+    state.P.Z = !result;
+    state.P.N = result & 0x80;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::CPX(uint16_t addr)
+{
+    uint8_t data = bus()->read(addr);
+    uint8_t result = state.X - data;
+
+    state.P.C = state.X >= data;
+    state.P.Z = !result;
+    state.P.N = result & 0x80;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::CPY(uint16_t addr)
+{
+    uint8_t data = bus()->read(addr);
+    uint8_t result = state.Y - data;
+
+    state.P.C = state.Y >= data;
+    state.P.Z = !result;
+    state.P.N = result & 0x80;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::DEC(uint16_t addr)
+{
+    uint8_t result = bus()->read(addr) - 1;
+    bus()->write(addr, result);
+
+    state.P.Z = result == 0;
+    state.P.N = result & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::DEX()
+{
+    --state.X;
+
+    state.P.Z = state.X == 0;
+    state.P.N = state.X & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::DEY()
+{
+    --state.Y;
+
+    state.P.Z = state.Y == 0;
+    state.P.N = state.Y & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::EOR(uint16_t addr)
+{
+    state.A ^= bus()->read(addr);
+
+    state.P.Z = state.A == 0;
+    state.P.N = state.A & 0x80;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::INC(uint16_t addr)
+{
+    uint8_t result = bus()->read(addr) + 1;
+    bus()->write(addr, result);
+
+    state.P.Z = result == 0;
+    state.P.N = result & 0x80;
+
+    cycle();
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::INX()
+{
+    ++state.X;
+
+    state.P.Z = state.X == 0;
+    state.P.N = state.X & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::INY()
+{
+    ++state.Y;
+
+    state.P.Z = state.Y == 0;
+    state.P.N = state.Y & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::JMP(uint16_t addr)
+{
+    state.PC = addr;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::JSR(uint16_t addr)
+{
+    bus()->write(0x100 + state.S--, (state.PC-1) >> 8);
+    bus()->write(0x100 + state.S--, (state.PC-1));
+
+    state.PC = addr;
+
+    cycle();
+    cycle();
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::LDA(uint16_t addr)
+{
+    state.A = bus()->read(addr);
+
+    state.P.Z = state.A == 0;
+    state.P.N = state.A & 0x80;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::LDX(uint16_t addr)
+{
+    state.X = bus()->read(addr);
+
+    state.P.Z = state.X == 0;
+    state.P.N = state.X & 0x80;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::LDY(uint16_t addr)
+{
+    state.Y = bus()->read(addr);
+
+    state.P.Z = state.Y == 0;
+    state.P.N = state.Y & 0x80;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::LSR(uint16_t addr, AddrMode addrMode)
+{
+    uint8_t data = addrMode == AddrMode::ACCUMULATOR ? state.A : bus()->read(addr);
+    uint8_t result = data >> 1;
+
+    state.P.C = data & 0x01;
+    state.P.Z = result == 0;
+    state.P.N = result & 0x80;
+
+    if (addrMode == AddrMode::ACCUMULATOR) {
+        state.A = result;
+    } else {
+        bus()->write(addr, result);
+        cycle();
+    }
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::NOP(uint16_t addr)
+{
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::ORA(uint16_t addr)
+{
+    state.A |= bus()->read(addr);
+
+    state.P.Z = state.A == 0;
+    state.P.N = state.A & 0x80;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::PHA()
+{
+    bus()->write(0x100 + state.S--, state.A);
+
+    cycle();
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::PHP()
+{
+    bus()->write(0x100 + state.S--, state.P.raw | 0x30);
+
+    cycle();
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::PLA()
+{
+    state.A = bus()->read(0x100 + (++state.S));
+
+    state.P.Z = state.A == 0;
+    state.P.N = state.A & 0x80;
+
+    cycle();
+    cycle();
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::PLP()
+{
+    //Bits 4 and 5 are ignored
+    state.P.raw = (state.P.raw & 0x30) | (bus()->read(0x100 + (++state.S)) & 0xCF);
+
+    cycle();
+    cycle();
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::ROL(uint16_t addr, AddrMode addrMode)
+{
+    uint8_t data = addrMode == AddrMode::ACCUMULATOR ? state.A : bus()->read(addr);
+    uint8_t carry = state.P.C ? 1 : 0;
+    state.P.C = data & 0x80;
+    uint8_t result = (data << 1) + carry;
+
+    state.P.Z = result == 0;
+    state.P.N = result & 0x80;
+
+    if (addrMode == AddrMode::ACCUMULATOR) {
+        state.A = result;
+    } else {
+        bus()->write(addr, result);
+        cycle();
+    }
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::ROR(uint16_t addr, AddrMode addrMode)
+{
+    uint8_t data = addrMode == AddrMode::ACCUMULATOR ? state.A : bus()->read(addr);
+    uint8_t carry = (state.P.C ? 1 : 0) << 7;
+    state.P.C = data & 0x01;
+    uint8_t result = (data >> 1) + carry;
+
+    state.P.Z = result == 0;
+    state.P.N = result & 0x80;
+
+    if (addrMode == AddrMode::ACCUMULATOR) {
+        state.A = result;
+    } else {
+        bus()->write(addr, result);
+        cycle();
+    }
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::RTI()
+{
+    state.P.raw = (state.P.raw & 0x30) | (bus()->read(0x100 + (++state.S)) & 0xCF);
+    state.PC = bus()->read(0x100 + (++state.S));
+    state.PC |= bus()->read(0x100 + (++state.S)) << 8;
+
+    cycle();
+    cycle();
+    cycle();
+    cycle();
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::RTS()
+{
+    state.PC = bus()->read(0x100 + (++state.S));
+    state.PC |= (bus()->read(0x100 + (++state.S)) << 8);
+    ++state.PC;
+
+    cycle();
+    cycle();
+    cycle();
+    cycle();
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::SBC(uint16_t addr)
+{
+    uint8_t mem = bus()->read(addr);
+    uint16_t result = state.A - mem - (state.P.C ? 0 : 1);
+    uint8_t temp = -mem - (state.P.C ? 0 : 1);
+
+    bool a = state.A & 0x80;
+    bool b = temp & 0x80;
+    bool r = result & 0x80;
+
+    state.P.V = ((r & !(a | b)) | (!r & a & b));
+
+    state.A = static_cast<uint8_t>(result);
+
+    state.P.Z = state.A == 0;
+    state.P.N = state.A & 0x80;
+    state.P.C = result <= 0xFF;
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::SEC()
+{
+    state.P.C = true;
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::SED()
+{
+    state.P.D = true;
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::SEI()
+{
+    state.P.I = true;
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::STA(uint16_t addr)
+{
+    bus()->write(addr, state.A);
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::STX(uint16_t addr)
+{
+    bus()->write(addr, state.X);
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::STY(uint16_t addr)
+{
+    bus()->write(addr, state.Y);
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::TAX()
+{
+    state.X = state.A;
+
+    state.P.Z = state.X == 0;
+    state.P.N = state.X & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::TAY()
+{
+    state.Y = state.A;
+
+    state.P.Z = state.Y == 0;
+    state.P.N = state.Y & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::TSX()
+{
+    state.X = state.S;
+
+    state.P.Z = state.X == 0;
+    state.P.N = state.X & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::TXA()
+{
+    state.A = state.X;
+
+    state.P.Z = state.A == 0;
+    state.P.N = state.A & 0x80;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::TXS()
+{
+    state.S = state.X;
+
+    cycle();
+}
+
+template<CpuAccuracy accuracy, class Bus>
+void CpuCore<accuracy, Bus>::TYA()
+{
+    state.A = state.Y;
+
+    state.P.Z = state.A == 0;
+    state.P.N = state.A & 0x80;
+
+    cycle();
+}
+
+#endif
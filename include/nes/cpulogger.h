@@ -12,10 +12,11 @@
 class CpuLogger
 {
 public:
+    //An empty filename disables the log
     CpuLogger(const std::string& filename);
 
     void setPC(uint16_t PC) { this->PC = PC; }
-    void setOpcode(Opcode opcode) { this->opcode = opcode; }
+    void setOpcode(const Opcode& opcode) { this->opcode = &opcode; }
     void addMemLocation(uint8_t memLocation) { memLocations.push_back(memLocation); }
     void setRegisters(uint8_t A, uint8_t X, uint8_t Y, uint8_t S, Bitfield P)
     {
@@ -28,18 +29,18 @@ public:
 
     void finishInstruction();
 private:
-    std::string getOpName() const;
     std::string getAddrStr() const;
 
     uint16_t PC;
     std::vector<uint8_t> memLocations;
-    Opcode opcode;
+    const Opcode* opcode;
     int A;
     int X;
     int Y;
     int S;
     Bitfield P;
 
+    bool enabled;
     int lineCount;
     std::ofstream file;
 };
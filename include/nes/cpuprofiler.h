@@ -0,0 +1,70 @@
+#ifndef CPUPROFILER_H
+#define CPUPROFILER_H
+
+#include "opdef.h"
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <ostream>
+
+//Sampling profiler fed by the Cpu after every instruction. PC is sampled every
+//sampleInterval CPU cycles together with a call stack rebuilt from JSR/BRK and RTS/RTI.
+//Opcode and addressing mode counters are exact.
+class CpuProfiler
+{
+public:
+    CpuProfiler(unsigned int sampleInterval = 1000);
+
+    void setSampleInterval(unsigned int interval) { sampleInterval = interval > 0 ? interval : 1; }
+
+    void onReset(uint16_t PC, uint64_t cycle);
+    //NMI and IRQ enter handler like a call from PC, RTI returns
+    void onInterrupt(uint16_t PC, uint16_t handler);
+    void onInstruction(uint16_t PC, uint8_t opId, const Opcode& opcode, uint64_t startCycle, uint64_t endCycle, uint16_t nextPC);
+
+    void clear();
+
+    void writeReport(std::ostream& os, unsigned int nbHotPcs = 20) const;
+    void writeFoldedStacks(std::ostream& os) const;
+    void writeCallgrind(std::ostream& os) const;
+
+private:
+    struct Frame
+    {
+        uint16_t entry;
+        uint16_t callSite;
+    };
+
+    struct Counter
+    {
+        uint64_t count;
+        uint64_t cycles;
+    };
+
+    static constexpr unsigned int maxStackDepth = 64;
+
+    void takeSamples(uint16_t PC, uint64_t nbSamples);
+    void pushFrame(uint16_t callSite, uint16_t entry);
+
+    unsigned int sampleInterval;
+    uint64_t nextSample;
+    uint64_t totalSamples;
+
+    std::array<Counter, 0x100> opcodeCounters;
+    std::array<Counter, static_cast<int>(AddrMode::BAD_MODE) + 1> addrModeCounters;
+    std::vector<uint64_t> pcSamples;
+
+    //callStack[0] is the root frame, pushed on reset
+    std::vector<Frame> callStack;
+    unsigned int droppedFrames;
+
+    //Key is every frame's entry and call site followed by the sampled PC
+    std::map<std::vector<uint16_t>, uint64_t> stackSamples;
+    //Key is (callSite << 16) | target
+    std::unordered_map<uint32_t, uint64_t> callCounts;
+};
+
+#endif
@@ -5,14 +5,31 @@
 
 #include <cstdint>
 #include <array>
+#include <cassert>
 
-class CpuRam : public IMemory
+class ByteReader;
+class ByteWriter;
+
+class CpuRam final : public IMemory
 {
 public:
     CpuRam();
 
-    virtual uint8_t read(uint16_t addr) override;
-    virtual void write(uint16_t addr, uint8_t data) override;
+    //Inline so the bus can access RAM without a call
+    uint8_t read(uint16_t addr) override
+    {
+        assert(addr < 0x0800);
+        return mem[addr];
+    }
+
+    void write(uint16_t addr, uint8_t data) override
+    {
+        assert(addr < 0x0800);
+        mem[addr] = data;
+    }
+
+    void saveState(ByteWriter& writer) const;
+    void loadState(ByteReader& reader);
 private:
     std::array<uint8_t, 0x0800> mem;
 };
@@ -0,0 +1,11 @@
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include <cstdint>
+#include <string>
+
+//bytes holds the whole instruction (opTable[bytes[0]].bytes long), PC is the address of its opcode
+std::string disassembleOperand(const uint8_t* bytes, uint16_t PC);
+std::string disassemble(const uint8_t* bytes, uint16_t PC);
+
+#endif
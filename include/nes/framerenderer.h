@@ -0,0 +1,97 @@
+#ifndef FRAMERENDERER_H
+#define FRAMERENDERER_H
+
+#include "scanlinerenderer.h"
+#include "ppubus.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Draws the visible lines of a frame on worker threads once the PPU is past them. While the frame
+//runs, the PPU only hands it the registers each line is drawn with and every write to its
+//memories, tagged with the first line that sees it. The workers start from a copy of the
+//memories as they were at the previous frame's handover and replay the writes. A CHR bank
+//switch is logged as writes of the whole bank.
+//A frame that writes CHR-RAM between its visible lines is drawn by one worker.
+class FrameRenderer
+{
+public:
+    enum class Target : uint8_t { PATTERNS, NAMETABLES, PALETTE, OAM };
+
+    //Starts from the bus's pattern space and a copy of memory
+    FrameRenderer(const PpuBus& bus, const PpuMemory& memory, unsigned int nbThreads);
+    ~FrameRenderer();
+
+    FrameRenderer(const FrameRenderer&) = delete;
+    FrameRenderer& operator=(const FrameRenderer&) = delete;
+
+    //addr is a pattern space address, an offset into the nametables or palette, or an OAM index
+    void logWrite(Target target, uint16_t addr, uint8_t data) { log.push_back({nextLine, target, addr, data}); }
+    void logLine(int scanline, const PpuLineRegisters& registers);
+
+    //Hands the lines logged since the last call to the workers and returns. frame must stay
+    //valid until wait() returns.
+    void renderFrame(uint32_t* frame);
+    //Returns once the frame given to renderFrame is drawn
+    void wait();
+
+    unsigned int getNbThreads() const { return workers.size(); }
+
+private:
+    static constexpr int nbLines = 240;
+
+    struct Write
+    {
+        uint8_t line;
+        Target target;
+        uint16_t addr;
+        uint8_t data;
+    };
+
+    struct Frame
+    {
+        std::vector<Write> log;
+        std::array<PpuLineRegisters, nbLines> registers;
+        std::array<bool, nbLines> logged;
+    };
+
+    void work();
+    void drawLines(int first, int last);
+    void apply(const Write& write, PpuMemory& target);
+
+    //Memories and pattern space as of the last handover, the workers only read them
+    PpuMemory memory;
+    std::array<uint8_t, 0x2000> patterns;
+    ChrTileCache tiles;
+
+    //Filled by the emulation thread
+    std::vector<Write> log;
+    std::array<PpuLineRegisters, nbLines> registers;
+    std::array<bool, nbLines> logged;
+    uint8_t nextLine;
+
+    //Being drawn. Writes before its first line are already in memory.
+    Frame drawing;
+    size_t firstWrite;
+    uint32_t* frame;
+    bool inFlight;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable done;
+    uint64_t generation;
+    bool quit;
+    unsigned int nbChunks;
+    //Generation in the high 32 bits, chunk index in the low ones
+    std::atomic<uint64_t> nextChunk;
+    unsigned int nbChunksLeft;
+};
+
+#endif
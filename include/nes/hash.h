@@ -0,0 +1,30 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+inline uint64_t fnv1a64(const uint8_t* data, size_t size, uint64_t hash = 0xCBF29CE484222325ULL)
+{
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+//CRC-32C (Castagnoli). Pass the previous result as crc to continue a running checksum.
+//Uses the SSE4.2 crc32 instruction when the CPU has it.
+uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc = 0);
+bool hasHardwareCrc32c();
+
+using Sha1Digest = std::array<uint8_t, 20>;
+
+//Uses the SHA extensions when the CPU has them
+Sha1Digest sha1(const uint8_t* data, size_t size);
+bool hasHardwareSha1();
+
+std::string toHex(const uint8_t* data, size_t size);
+
+#endif
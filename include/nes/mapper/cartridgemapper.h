@@ -2,48 +2,120 @@
 #define CARTRIDGEMAPPER_H
 
 #include "imemory.h"
+#include "busaccess.h"
+#include "prgcoverage.h"
+#include "romarchive.h"
+#include "rombuffer.h"
+#include "span.h"
 
 #include <string>
-#include <vector>
-#include <array>
+#include <memory>
+
+class ByteReader;
+class ByteWriter;
+class PpuBus;
 
 enum class Mirroring { VERTICAL, HORIZONTAL, FOUR_SCREEN, SINGLE_SCREEN, BAD_MIRRORING };
 
+//The 16 byte iNES header, decoded
+struct INesHeader
+{
+    uint8_t nbPrgRom = 0;
+    uint8_t nbChrRom = 0;
+    int mapperId = -1;
+    Mirroring mirroring = Mirroring::BAD_MIRRORING;
+    bool nes2 = false;
+    bool battery = false;
+    bool trainer = false;
+    bool vsUnisystem = false;
+    bool playchoice = false;
+};
+
+//Where the load time went, decompressSeconds is 0 for plain .nes files
+struct CartridgeLoadStats
+{
+    uint64_t fileBytes = 0;
+    uint64_t romBytes = 0;
+    RomCompression compression = RomCompression::NONE;
+    double decompressSeconds = 0.0;
+    double totalSeconds = 0.0;
+};
+
+//Contents of an iNES file, before a mapper is picked for it. The ROM spans point into buffer.
+struct CartridgeImage
+{
+    int mapperId = -1;
+    Mirroring mirroring = Mirroring::BAD_MIRRORING;
+    bool battery = false;
+    std::shared_ptr<const RomBuffer> buffer;
+    ByteSpan prgRom;
+    ByteSpan chrRom;
+    //Where battery-backed RAM is kept, empty to keep it in memory
+    std::string saveFilename;
+    CartridgeLoadStats loadStats;
+};
+
 class CartridgeMapper
 {
 public:
-    CartridgeMapper(Mirroring mirroring, const std::vector<std::array<uint8_t, 0x4000>>& prgRom, const std::vector<std::array<uint8_t, 0x2000>>& chrRom);
+    CartridgeMapper(const CartridgeImage& image);
+    virtual ~CartridgeMapper();
 
     int getMapperId() const { return mapperId; }
     Mirroring getMirroring() const { return mirroring; }
+    bool hasBattery() const { return battery; }
+    //The whole iNES file, header included
+    ByteSpan getRomBytes() const { return buffer->getBytes(); }
 
-    virtual uint8_t readCpuBus(uint16_t addr) = 0;
-    virtual uint8_t readPpuBus(uint16_t addr) = 0;
+    //Only complete on the ACCURATE CPU tier, FAST fetches opcodes and operands without marking them
+    void enableCoverage();
+    PrgCoverage* getPrgCoverage() const { return prgCoverage.get(); }
 
+    //Maps the CHR banks and mirroring into the PPU's address space, mappers map them again
+    //whenever they switch them
+    void setPpuBus(PpuBus* ppuBus)
+    {
+        this->ppuBus = ppuBus;
+        mapPpuBus();
+    }
+
+    //Called between frames, battery-backed mappers flush their save RAM
+    virtual void endFrame() {}
+
+    //Bank registers and RAM, nothing for mappers without either
+    virtual void saveState(ByteWriter& writer) const {}
+    virtual void loadState(ByteReader& reader) {}
+
+    virtual uint8_t readCpuBus(uint16_t addr, BusAccess access) = 0;
     virtual void writeCpuBus(uint16_t addr, uint8_t data) = 0;
-    virtual void writePpuBus(uint16_t addr, uint8_t data) = 0;
+    //What readCpuBus would return, without touching registers or the coverage map
+    virtual uint8_t peekCpuBus(uint16_t addr) const = 0;
 
 protected:
+    //The header's mirroring and the first 8KB of CHR-ROM
+    virtual void mapPpuBus();
+
     Mirroring mirroring;
     int mapperId;
+    bool battery;
 
-    std::vector<uint8_t> prgRom;
-    std::vector<uint8_t> chrRom;
-};
-
-CartridgeMapper* loadCartridgeMapperFromFile(const std::string& filename);
+    //Keeps the spans valid, nothing is copied out of the file
+    std::shared_ptr<const RomBuffer> buffer;
+    ByteSpan prgRom;
+    ByteSpan chrRom;
 
-template<size_t N>
-std::vector<uint8_t> toContiguousVector(const std::vector<std::array<uint8_t, N>>& data)
-{
-    std::vector<uint8_t> vec(N * data.size());
+    PpuBus* ppuBus;
 
-    auto currentPos = vec.begin();
-    for (const auto& arr : data) {
-        currentPos = std::copy(arr.cbegin(), arr.cend(), currentPos);
-    }
+    //Only allocated in coverage mode, mappers mark every PRG-ROM read they serve
+    std::unique_ptr<PrgCoverage> prgCoverage;
+};
 
-    return vec;
-}
+//Returns false if bytes doesn't start with an iNES header. Doesn't print anything.
+bool parseINesHeader(ByteSpan bytes, INesHeader& header);
+//Also loads .nes.gz and .zip files. verbose prints the header contents, errors are always printed.
+bool loadCartridgeImage(const std::string& filename, CartridgeImage& image, bool verbose = true);
+//Validates the iNES header in buffer, filename is only used in messages
+bool parseCartridgeImage(std::shared_ptr<const RomBuffer> buffer, const std::string& filename, CartridgeImage& image, bool verbose = true);
+CartridgeMapper* loadCartridgeMapperFromFile(const std::string& filename, bool verbose = true);
 
 #endif
@@ -2,23 +2,62 @@
 #define CARTRIDGEMAPPER001_H
 
 #include "cartridgemapper.h"
+#include "saveram.h"
 
 #include <vector>
-#include <array>
 
-class CartridgeMapper001 : public CartridgeMapper
+class CartridgeMapper001 final : public CartridgeMapper
 {
 public:
-    CartridgeMapper001(Mirroring mirroring, const std::vector<std::array<uint8_t, 0x4000>>& prgRom, const std::vector<std::array<uint8_t, 0x2000>>& chrRom);
-
-    uint8_t readCpuBus(uint16_t addr) override;
-    uint8_t readPpuBus(uint16_t addr) override;
+    CartridgeMapper001(const CartridgeImage& image);
 
+    uint8_t readCpuBus(uint16_t addr, BusAccess access) override;
     void writeCpuBus(uint16_t addr, uint8_t data) override;
-    void writePpuBus(uint16_t addr, uint8_t data) override;
+    uint8_t peekCpuBus(uint16_t addr) const override;
+
+    void endFrame() override { prgRam.flush(); }
+
+    void saveState(ByteWriter& writer) const override;
+    void loadState(ByteReader& reader) override;
+
+protected:
+    void mapPpuBus() override;
+
 private:
-    std::array<uint8_t, 0x2000> prgRam;
+    SaveRam prgRam;
+    //8KB when the cartridge has no CHR-ROM, empty otherwise
+    std::vector<uint8_t> chrRam;
     uint16_t prgRomMask;
 };
 
+//The CPU bus accesses are in the header so System<CartridgeMapper001> can inline them
+
+inline uint8_t CartridgeMapper001::readCpuBus(uint16_t addr, BusAccess access)
+{
+    if (prgCoverage && addr >= 0x8000) {
+        prgCoverage->mark((addr & prgRomMask) - 0x8000, access);
+    }
+
+    return peekCpuBus(addr);
+}
+
+inline uint8_t CartridgeMapper001::peekCpuBus(uint16_t addr) const
+{
+    if (addr < 0x6000) { //Nothing is mapped from $4020 to $5FFF
+        return 0;
+    } else if (addr < 0x8000) {
+        return prgRam.read(addr - 0x6000);
+    }
+
+    return prgRom[(addr & prgRomMask) - 0x8000];
+}
+
+inline void CartridgeMapper001::writeCpuBus(uint16_t addr, uint8_t data)
+{
+    //PRG-ROM is read-only and nothing is mapped from $4020 to $5FFF
+    if (addr >= 0x6000 && addr < 0x8000) {
+        prgRam.write(addr - 0x6000, data);
+    }
+}
+
 #endif
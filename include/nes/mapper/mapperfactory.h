@@ -0,0 +1,24 @@
+#ifndef MAPPERFACTORY_H
+#define MAPPERFACTORY_H
+
+#include "cartridgemapper.h"
+#include "cartridgemapper001.h"
+
+#include <iostream>
+#include <memory>
+
+//The only place that maps an iNES mapper number to a type. factory is called with a
+//std::unique_ptr to the concrete mapper so callers can instantiate templates on it.
+template<class Result, class Factory>
+Result instantiateMapper(const CartridgeImage& image, Factory&& factory)
+{
+    switch (image.mapperId) {
+    case 0:
+        return factory(std::make_unique<CartridgeMapper001>(image));
+    default:
+        std::cout << "Mapper #" << image.mapperId << " is not supported." << std::endl;
+        return Result();
+    }
+}
+
+#endif
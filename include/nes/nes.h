@@ -0,0 +1,81 @@
+#ifndef NES_H
+#define NES_H
+
+#include "system.h"
+#include "perfcounters.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//What loadCartridge did with the BootCache
+enum class BootSnapshot
+{
+    NONE,           //The cache is disabled, the machine starts from power-up
+    LOADED,         //Resumed from the ROM's snapshot
+    STORED,         //There was no snapshot, the warmup ran and one was taken
+    REJECTED,       //loadState refused the snapshot, the warmup ran and it was taken again
+    BATTERY_BACKED, //The warmup ran, a snapshot would overwrite the save file
+    STORE_FAILED    //The warmup ran but the snapshot couldn't be written
+};
+
+class Nes
+{
+public:
+    //NTSC frame length. The PPU runs 3 dots per CPU cycle.
+    static constexpr unsigned int ppuDotsPerFrame = 341 * 262;
+
+    Nes(const std::string& cpuLogFilename = "cpu_log.txt", CpuAccuracy accuracy = CpuAccuracy::ACCURATE);
+
+    //Builds a new System for the cartridge, the machine starts from power-up. With the
+    //BootCache enabled it starts after the warmup frames instead, from the ROM's snapshot
+    //when there is one.
+    bool loadCartridge(const std::string& filename, bool verbose = true);
+    //Without render, the frame isn't drawn and the PPU's frame keeps the last one that was. The
+    //emulation is the same, the flags games poll are still raised.
+    void runFrame(bool render = true);
+    void reset() { system->getCpu().reset(); }
+
+    //Reads RAM or cartridge space without any side effect on the emulation
+    uint8_t peek(uint16_t addr) { return system ? system->peek(addr) : 0; }
+
+    //Only valid once a cartridge is loaded
+    Cpu& getCpu() { return system->getCpu(); }
+    CpuBus& getBus() { return system->getBus(); }
+    Ppu& getPpu() { return system->getPpu(); }
+    CartridgeMapper* getCartridge() const { return system ? system->getCartridge() : nullptr; }
+    uint64_t getFrameCount() const { return frameCount; }
+    const CartridgeLoadStats& getLoadStats() const { return loadStats; }
+
+    BootSnapshot getBootSnapshot() const { return bootSnapshot; }
+    bool isBootedFromSnapshot() const { return bootSnapshot == BootSnapshot::LOADED; }
+
+    //Whole machine state. loadState leaves the machine alone and returns false if state
+    //comes from another emulator version, mapper or CPU tier.
+    void saveState(std::vector<uint8_t>& state) const;
+    bool loadState(ByteSpan state);
+
+    void setPerfCounters(PerfCounters* perfCounters) { this->perfCounters = perfCounters; }
+
+    //Threads drawing the visible lines once the PPU is past them, 0 to draw each line as it's
+    //reached. Kept for later cartridges. runFrame returns once the frame is drawn either way.
+    void setRenderThreads(unsigned int nbThreads);
+
+private:
+    void boot();
+    void runCpu(uint64_t deadline);
+
+    std::string cpuLogFilename;
+    CpuAccuracy accuracy;
+    std::unique_ptr<ISystem> system;
+    CartridgeLoadStats loadStats;
+
+    uint64_t frameCount;
+    BootSnapshot bootSnapshot;
+    unsigned int renderThreads;
+
+    PerfCounters* perfCounters;
+};
+
+#endif
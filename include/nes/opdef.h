@@ -1,6 +1,8 @@
 #ifndef OPDEF_H
 #define OPDEF_H
 
+#include <cstdint>
+
 enum class AddrMode
 {
     IMPLICIT,
@@ -33,10 +35,51 @@ enum class Op
     BAD_OP
 };
 
+//Processor status bits, as used by Opcode::flagsRead and Opcode::flagsWritten
+enum StatusFlag : uint8_t
+{
+    FLAG_C = 0x01,
+    FLAG_Z = 0x02,
+    FLAG_I = 0x04,
+    FLAG_D = 0x08,
+    FLAG_V = 0x40,
+    FLAG_N = 0x80,
+    FLAG_ALL = 0xCF
+};
+
+//One entry of opTable (optable.h)
 struct Opcode
 {
     Op op;
     AddrMode addrMode;
+    const char* mnemonic;
+    uint8_t bytes;
+    //Documented cycle count, not counting branch and page crossing penalties
+    uint8_t cycles;
+    bool pageCrossPenalty;
+    uint8_t flagsRead;
+    uint8_t flagsWritten;
+};
+
+inline constexpr const char* opNames[] = {
+    "ADC", "AND", "ASL", "BCC", "BCS", "BEQ", "BIT", "BMI",
+    "BNE", "BPL", "BRK", "BVC", "BVS", "CLC", "CLD", "CLI",
+    "CLV", "CMP", "CPX", "CPY", "DEC", "DEX", "DEY", "EOR",
+    "INC", "INX", "INY", "JMP", "JSR", "LDA", "LDX", "LDY",
+    "LSR", "NOP", "ORA", "PHA", "PHP", "PLA", "PLP", "ROL",
+    "ROR", "RTI", "RTS", "SBC", "SEC", "SED", "SEI", "STA",
+    "STX", "STY", "TAX", "TAY", "TSX", "TXA", "TXS", "TYA",
+    "STP", "SLO", "ANC", "RLA", "SRE", "RRA", "ARR", "SAX",
+    "AHX", "TAS", "LAS", "DCP", "AXS", "ISC", "ALR"
 };
 
+static_assert(sizeof(opNames) / sizeof(opNames[0]) == static_cast<int>(Op::BAD_OP), "Op names out of sync");
+
+constexpr const char* opName(Op op)
+{
+    return op < Op::BAD_OP ? opNames[static_cast<int>(op)] : "UNKNOWN";
+}
+
+const char* addrModeName(AddrMode addrMode);
+
 #endif
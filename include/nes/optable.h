@@ -0,0 +1,382 @@
+#ifndef OPTABLE_H
+#define OPTABLE_H
+
+#include "opdef.h"
+
+#include <array>
+#include <cstdint>
+
+//Static description of every opcode, built at compile time. Cpu decodes with it, the
+//logger, the disassembler and the profiler read lengths, mnemonics and cycle counts from it.
+
+namespace optable_detail
+{
+struct Entry
+{
+    uint8_t opcode;
+    Op op;
+    AddrMode addrMode;
+    uint8_t cycles;
+    bool pageCrossPenalty;
+};
+
+constexpr Entry entries[] = {
+    {0x69, Op::ADC, AddrMode::IMMEDIATE, 2, false},
+    {0x65, Op::ADC, AddrMode::ZERO_PAGE, 3, false},
+    {0x75, Op::ADC, AddrMode::ZERO_PAGE_X, 4, false},
+    {0x6D, Op::ADC, AddrMode::ABSOLUTE, 4, false},
+    {0x7D, Op::ADC, AddrMode::ABSOLUTE_X, 4, true},
+    {0x79, Op::ADC, AddrMode::ABSOLUTE_Y, 4, true},
+    {0x61, Op::ADC, AddrMode::INDEXED_INDIRECT, 6, false},
+    {0x71, Op::ADC, AddrMode::INDIRECT_INDEXED, 5, true},
+
+    {0x29, Op::AND, AddrMode::IMMEDIATE, 2, false},
+    {0x25, Op::AND, AddrMode::ZERO_PAGE, 3, false},
+    {0x35, Op::AND, AddrMode::ZERO_PAGE_X, 4, false},
+    {0x2D, Op::AND, AddrMode::ABSOLUTE, 4, false},
+    {0x3D, Op::AND, AddrMode::ABSOLUTE_X, 4, true},
+    {0x39, Op::AND, AddrMode::ABSOLUTE_Y, 4, true},
+    {0x21, Op::AND, AddrMode::INDEXED_INDIRECT, 6, false},
+    {0x31, Op::AND, AddrMode::INDIRECT_INDEXED, 5, true},
+
+    {0x0A, Op::ASL, AddrMode::ACCUMULATOR, 2, false},
+    {0x06, Op::ASL, AddrMode::ZERO_PAGE, 5, false},
+    {0x16, Op::ASL, AddrMode::ZERO_PAGE_X, 6, false},
+    {0x0E, Op::ASL, AddrMode::ABSOLUTE, 6, false},
+    {0x1E, Op::ASL, AddrMode::ABSOLUTE_X, 7, false},
+
+    {0x90, Op::BCC, AddrMode::RELATIVE, 2, false},
+
+    {0xB0, Op::BCS, AddrMode::RELATIVE, 2, false},
+
+    {0xF0, Op::BEQ, AddrMode::RELATIVE, 2, false},
+
+    {0x24, Op::BIT, AddrMode::ZERO_PAGE, 3, false},
+    {0x2C, Op::BIT, AddrMode::ABSOLUTE, 4, false},
+
+    {0x30, Op::BMI, AddrMode::RELATIVE, 2, false},
+
+    {0xD0, Op::BNE, AddrMode::RELATIVE, 2, false},
+
+    {0x10, Op::BPL, AddrMode::RELATIVE, 2, false},
+
+    {0x00, Op::BRK, AddrMode::IMPLICIT, 7, false},
+
+    {0x50, Op::BVC, AddrMode::RELATIVE, 2, false},
+
+    {0x70, Op::BVS, AddrMode::RELATIVE, 2, false},
+
+    {0x18, Op::CLC, AddrMode::IMPLICIT, 2, false},
+
+    {0xD8, Op::CLD, AddrMode::IMPLICIT, 2, false},
+
+    {0x58, Op::CLI, AddrMode::IMPLICIT, 2, false},
+
+    {0xB8, Op::CLV, AddrMode::IMPLICIT, 2, false},
+
+    {0xC9, Op::CMP, AddrMode::IMMEDIATE, 2, false},
+    {0xC5, Op::CMP, AddrMode::ZERO_PAGE, 3, false},
+    {0xD5, Op::CMP, AddrMode::ZERO_PAGE_X, 4, false},
+    {0xCD, Op::CMP, AddrMode::ABSOLUTE, 4, false},
+    {0xDD, Op::CMP, AddrMode::ABSOLUTE_X, 4, true},
+    {0xD9, Op::CMP, AddrMode::ABSOLUTE_Y, 4, true},
+    {0xC1, Op::CMP, AddrMode::INDEXED_INDIRECT, 6, false},
+    {0xD1, Op::CMP, AddrMode::INDIRECT_INDEXED, 5, true},
+
+    {0xE0, Op::CPX, AddrMode::IMMEDIATE, 2, false},
+    {0xE4, Op::CPX, AddrMode::ZERO_PAGE, 3, false},
+    {0xEC, Op::CPX, AddrMode::ABSOLUTE, 4, false},
+
+    {0xC0, Op::CPY, AddrMode::IMMEDIATE, 2, false},
+    {0xC4, Op::CPY, AddrMode::ZERO_PAGE, 3, false},
+    {0xCC, Op::CPY, AddrMode::ABSOLUTE, 4, false},
+
+    {0xC6, Op::DEC, AddrMode::ZERO_PAGE, 5, false},
+    {0xD6, Op::DEC, AddrMode::ZERO_PAGE_X, 6, false},
+    {0xCE, Op::DEC, AddrMode::ABSOLUTE, 6, false},
+    {0xDE, Op::DEC, AddrMode::ABSOLUTE_X, 7, false},
+
+    {0xCA, Op::DEX, AddrMode::IMPLICIT, 2, false},
+
+    {0x88, Op::DEY, AddrMode::IMPLICIT, 2, false},
+
+    {0x49, Op::EOR, AddrMode::IMMEDIATE, 2, false},
+    {0x45, Op::EOR, AddrMode::ZERO_PAGE, 3, false},
+    {0x55, Op::EOR, AddrMode::ZERO_PAGE_X, 4, false},
+    {0x4D, Op::EOR, AddrMode::ABSOLUTE, 4, false},
+    {0x5D, Op::EOR, AddrMode::ABSOLUTE_X, 4, true},
+    {0x59, Op::EOR, AddrMode::ABSOLUTE_Y, 4, true},
+    {0x41, Op::EOR, AddrMode::INDEXED_INDIRECT, 6, false},
+    {0x51, Op::EOR, AddrMode::INDIRECT_INDEXED, 5, true},
+
+    {0xE6, Op::INC, AddrMode::ZERO_PAGE, 5, false},
+    {0xF6, Op::INC, AddrMode::ZERO_PAGE_X, 6, false},
+    {0xEE, Op::INC, AddrMode::ABSOLUTE, 6, false},
+    {0xFE, Op::INC, AddrMode::ABSOLUTE_X, 7, false},
+
+    {0xE8, Op::INX, AddrMode::IMPLICIT, 2, false},
+
+    {0xC8, Op::INY, AddrMode::IMPLICIT, 2, false},
+
+    {0x4C, Op::JMP, AddrMode::ABSOLUTE, 3, false},
+    {0x6C, Op::JMP, AddrMode::INDIRECT, 5, false},
+
+    {0x20, Op::JSR, AddrMode::ABSOLUTE, 6, false},
+
+    {0xA9, Op::LDA, AddrMode::IMMEDIATE, 2, false},
+    {0xA5, Op::LDA, AddrMode::ZERO_PAGE, 3, false},
+    {0xB5, Op::LDA, AddrMode::ZERO_PAGE_X, 4, false},
+    {0xAD, Op::LDA, AddrMode::ABSOLUTE, 4, false},
+    {0xBD, Op::LDA, AddrMode::ABSOLUTE_X, 4, true},
+    {0xB9, Op::LDA, AddrMode::ABSOLUTE_Y, 4, true},
+    {0xA1, Op::LDA, AddrMode::INDEXED_INDIRECT, 6, false},
+    {0xB1, Op::LDA, AddrMode::INDIRECT_INDEXED, 5, true},
+
+    {0xA2, Op::LDX, AddrMode::IMMEDIATE, 2, false},
+    {0xA6, Op::LDX, AddrMode::ZERO_PAGE, 3, false},
+    {0xB6, Op::LDX, AddrMode::ZERO_PAGE_Y, 4, false},
+    {0xAE, Op::LDX, AddrMode::ABSOLUTE, 4, false},
+    {0xBE, Op::LDX, AddrMode::ABSOLUTE_Y, 4, true},
+
+    {0xA0, Op::LDY, AddrMode::IMMEDIATE, 2, false},
+    {0xA4, Op::LDY, AddrMode::ZERO_PAGE, 3, false},
+    {0xB4, Op::LDY, AddrMode::ZERO_PAGE_X, 4, false},
+    {0xAC, Op::LDY, AddrMode::ABSOLUTE, 4, false},
+    {0xBC, Op::LDY, AddrMode::ABSOLUTE_X, 4, true},
+
+    {0x4A, Op::LSR, AddrMode::ACCUMULATOR, 2, false},
+    {0x46, Op::LSR, AddrMode::ZERO_PAGE, 5, false},
+    {0x56, Op::LSR, AddrMode::ZERO_PAGE_X, 6, false},
+    {0x4E, Op::LSR, AddrMode::ABSOLUTE, 6, false},
+    {0x5E, Op::LSR, AddrMode::ABSOLUTE_X, 7, false},
+
+    {0xEA, Op::NOP, AddrMode::IMPLICIT, 2, false},
+    {0x04, Op::NOP, AddrMode::ZERO_PAGE, 3, false},
+    {0x0C, Op::NOP, AddrMode::ABSOLUTE, 4, false},
+    {0x14, Op::NOP, AddrMode::ZERO_PAGE_X, 4, false},
+    {0x1A, Op::NOP, AddrMode::IMPLICIT, 2, false},
+    {0x1C, Op::NOP, AddrMode::ABSOLUTE_X, 4, true},
+    {0x34, Op::NOP, AddrMode::ZERO_PAGE_X, 4, false},
+    {0x3A, Op::NOP, AddrMode::IMPLICIT, 2, false},
+    {0x3C, Op::NOP, AddrMode::ABSOLUTE_X, 4, true},
+    {0x44, Op::NOP, AddrMode::ZERO_PAGE, 3, false},
+    {0x54, Op::NOP, AddrMode::ZERO_PAGE_X, 4, false},
+    {0x5A, Op::NOP, AddrMode::IMPLICIT, 2, false},
+    {0x5C, Op::NOP, AddrMode::ABSOLUTE_X, 4, true},
+    {0x64, Op::NOP, AddrMode::ZERO_PAGE, 3, false},
+    {0x74, Op::NOP, AddrMode::ZERO_PAGE_X, 4, false},
+    {0x7A, Op::NOP, AddrMode::IMPLICIT, 2, false},
+    {0x7C, Op::NOP, AddrMode::ABSOLUTE_X, 4, true},
+    {0x80, Op::NOP, AddrMode::IMMEDIATE, 2, false},
+    {0x82, Op::NOP, AddrMode::IMMEDIATE, 2, false},
+    {0x89, Op::NOP, AddrMode::IMMEDIATE, 2, false},
+    {0xC2, Op::NOP, AddrMode::IMMEDIATE, 2, false},
+    {0xD4, Op::NOP, AddrMode::ZERO_PAGE_X, 4, false},
+    {0xDA, Op::NOP, AddrMode::IMPLICIT, 2, false},
+    {0xDC, Op::NOP, AddrMode::ABSOLUTE_X, 4, true},
+    {0xE2, Op::NOP, AddrMode::IMMEDIATE, 2, false},
+    {0xF4, Op::NOP, AddrMode::ZERO_PAGE_X, 4, false},
+    {0xFA, Op::NOP, AddrMode::IMPLICIT, 2, false},
+    {0xFC, Op::NOP, AddrMode::ABSOLUTE_X, 4, true},
+
+    {0x09, Op::ORA, AddrMode::IMMEDIATE, 2, false},
+    {0x05, Op::ORA, AddrMode::ZERO_PAGE, 3, false},
+    {0x15, Op::ORA, AddrMode::ZERO_PAGE_X, 4, false},
+    {0x0D, Op::ORA, AddrMode::ABSOLUTE, 4, false},
+    {0x1D, Op::ORA, AddrMode::ABSOLUTE_X, 4, true},
+    {0x19, Op::ORA, AddrMode::ABSOLUTE_Y, 4, true},
+    {0x01, Op::ORA, AddrMode::INDEXED_INDIRECT, 6, false},
+    {0x11, Op::ORA, AddrMode::INDIRECT_INDEXED, 5, true},
+
+    {0x48, Op::PHA, AddrMode::IMPLICIT, 3, false},
+
+    {0x08, Op::PHP, AddrMode::IMPLICIT, 3, false},
+
+    {0x68, Op::PLA, AddrMode::IMPLICIT, 4, false},
+
+    {0x28, Op::PLP, AddrMode::IMPLICIT, 4, false},
+
+    {0x2A, Op::ROL, AddrMode::ACCUMULATOR, 2, false},
+    {0x26, Op::ROL, AddrMode::ZERO_PAGE, 5, false},
+    {0x36, Op::ROL, AddrMode::ZERO_PAGE_X, 6, false},
+    {0x2E, Op::ROL, AddrMode::ABSOLUTE, 6, false},
+    {0x3E, Op::ROL, AddrMode::ABSOLUTE_X, 7, false},
+
+    {0x6A, Op::ROR, AddrMode::ACCUMULATOR, 2, false},
+    {0x66, Op::ROR, AddrMode::ZERO_PAGE, 5, false},
+    {0x76, Op::ROR, AddrMode::ZERO_PAGE_X, 6, false},
+    {0x6E, Op::ROR, AddrMode::ABSOLUTE, 6, false},
+    {0x7E, Op::ROR, AddrMode::ABSOLUTE_X, 7, false},
+
+    {0x40, Op::RTI, AddrMode::IMPLICIT, 6, false},
+
+    {0x60, Op::RTS, AddrMode::IMPLICIT, 6, false},
+
+    {0xE9, Op::SBC, AddrMode::IMMEDIATE, 2, false},
+    {0xEB, Op::SBC, AddrMode::IMMEDIATE, 2, false},
+    {0xE5, Op::SBC, AddrMode::ZERO_PAGE, 3, false},
+    {0xF5, Op::SBC, AddrMode::ZERO_PAGE_X, 4, false},
+    {0xED, Op::SBC, AddrMode::ABSOLUTE, 4, false},
+    {0xFD, Op::SBC, AddrMode::ABSOLUTE_X, 4, true},
+    {0xF9, Op::SBC, AddrMode::ABSOLUTE_Y, 4, true},
+    {0xE1, Op::SBC, AddrMode::INDEXED_INDIRECT, 6, false},
+    {0xF1, Op::SBC, AddrMode::INDIRECT_INDEXED, 5, true},
+
+    {0x38, Op::SEC, AddrMode::IMPLICIT, 2, false},
+
+    {0xF8, Op::SED, AddrMode::IMPLICIT, 2, false},
+
+    {0x78, Op::SEI, AddrMode::IMPLICIT, 2, false},
+
+    {0x85, Op::STA, AddrMode::ZERO_PAGE, 3, false},
+    {0x95, Op::STA, AddrMode::ZERO_PAGE_X, 4, false},
+    {0x8D, Op::STA, AddrMode::ABSOLUTE, 4, false},
+    {0x9D, Op::STA, AddrMode::ABSOLUTE_X, 5, false},
+    {0x99, Op::STA, AddrMode::ABSOLUTE_Y, 5, false},
+    {0x81, Op::STA, AddrMode::INDEXED_INDIRECT, 6, false},
+    {0x91, Op::STA, AddrMode::INDIRECT_INDEXED, 6, false},
+
+    {0x86, Op::STX, AddrMode::ZERO_PAGE, 3, false},
+    {0x96, Op::STX, AddrMode::ZERO_PAGE_Y, 4, false},
+    {0x8E, Op::STX, AddrMode::ABSOLUTE, 4, false},
+
+    {0x84, Op::STY, AddrMode::ZERO_PAGE, 3, false},
+    {0x94, Op::STY, AddrMode::ZERO_PAGE_X, 4, false},
+    {0x8C, Op::STY, AddrMode::ABSOLUTE, 4, false},
+
+    {0xAA, Op::TAX, AddrMode::IMPLICIT, 2, false},
+
+    {0xA8, Op::TAY, AddrMode::IMPLICIT, 2, false},
+
+    {0xBA, Op::TSX, AddrMode::IMPLICIT, 2, false},
+
+    {0x8A, Op::TXA, AddrMode::IMPLICIT, 2, false},
+
+    {0x9A, Op::TXS, AddrMode::IMPLICIT, 2, false},
+
+    {0x98, Op::TYA, AddrMode::IMPLICIT, 2, false},
+};
+
+constexpr uint8_t instructionBytes(AddrMode addrMode)
+{
+    switch (addrMode) {
+    case AddrMode::IMPLICIT:
+    case AddrMode::ACCUMULATOR:
+        return 1;
+    case AddrMode::ABSOLUTE:
+    case AddrMode::ABSOLUTE_X:
+    case AddrMode::ABSOLUTE_Y:
+    case AddrMode::INDIRECT:
+        return 3;
+    case AddrMode::BAD_MODE:
+        return 1;
+    default:
+        return 2;
+    }
+}
+
+constexpr uint8_t flagsRead(Op op)
+{
+    switch (op) {
+    case Op::ADC:
+    case Op::SBC:
+    case Op::ROL:
+    case Op::ROR:
+    case Op::BCC:
+    case Op::BCS:
+        return FLAG_C;
+    case Op::BEQ:
+    case Op::BNE:
+        return FLAG_Z;
+    case Op::BMI:
+    case Op::BPL:
+        return FLAG_N;
+    case Op::BVC:
+    case Op::BVS:
+        return FLAG_V;
+    case Op::BRK:
+    case Op::PHP:
+        return FLAG_ALL;
+    default:
+        return 0;
+    }
+}
+
+constexpr uint8_t flagsWritten(Op op)
+{
+    switch (op) {
+    case Op::ADC:
+    case Op::SBC:
+        return FLAG_N | FLAG_V | FLAG_Z | FLAG_C;
+    case Op::AND:
+    case Op::EOR:
+    case Op::ORA:
+    case Op::LDA:
+    case Op::LDX:
+    case Op::LDY:
+    case Op::DEC:
+    case Op::DEX:
+    case Op::DEY:
+    case Op::INC:
+    case Op::INX:
+    case Op::INY:
+    case Op::PLA:
+    case Op::TAX:
+    case Op::TAY:
+    case Op::TSX:
+    case Op::TXA:
+    case Op::TYA:
+        return FLAG_N | FLAG_Z;
+    case Op::ASL:
+    case Op::LSR:
+    case Op::ROL:
+    case Op::ROR:
+    case Op::CMP:
+    case Op::CPX:
+    case Op::CPY:
+        return FLAG_N | FLAG_Z | FLAG_C;
+    case Op::BIT:
+        return FLAG_N | FLAG_V | FLAG_Z;
+    case Op::CLC:
+    case Op::SEC:
+        return FLAG_C;
+    case Op::CLD:
+    case Op::SED:
+        return FLAG_D;
+    case Op::CLI:
+    case Op::SEI:
+    case Op::BRK:
+        return FLAG_I;
+    case Op::CLV:
+        return FLAG_V;
+    case Op::PLP:
+    case Op::RTI:
+        return FLAG_ALL;
+    default:
+        return 0;
+    }
+}
+
+constexpr std::array<Opcode, 0x100> makeOpTable()
+{
+    std::array<Opcode, 0x100> table {};
+
+    for (auto& opcode : table) {
+        opcode = {Op::BAD_OP, AddrMode::BAD_MODE, opName(Op::BAD_OP), 1, 0, false, 0, 0};
+    }
+
+    for (const auto& entry : entries) {
+        table[entry.opcode] = {entry.op, entry.addrMode, opName(entry.op), instructionBytes(entry.addrMode),
+                               entry.cycles, entry.pageCrossPenalty, flagsRead(entry.op), flagsWritten(entry.op)};
+    }
+
+    return table;
+}
+}
+
+inline constexpr std::array<Opcode, 0x100> opTable = optable_detail::makeOpTable();
+
+static_assert(opTable[0xA9].op == Op::LDA && opTable[0xA9].bytes == 2 && opTable[0xA9].cycles == 2, "opTable is broken");
+static_assert(opTable[0x02].op == Op::BAD_OP, "opTable is broken");
+
+#endif
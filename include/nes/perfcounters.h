@@ -0,0 +1,59 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <array>
+#include <ostream>
+
+enum class PerfSlice { FRAME, CPU, PPU, PRESENT, COUNT };
+
+//Host hardware counters read with perf_event_open around emulator slices.
+//Only available on Linux, elsewhere (or when the kernel refuses) every call is a no-op.
+class PerfCounters
+{
+public:
+    enum Event { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, NB_EVENTS };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool isAvailable() const { return groupFd >= 0; }
+
+    void begin(PerfSlice slice);
+    void end(PerfSlice slice, uint64_t emulatedInstructions = 0);
+
+    void clear();
+    void writeReport(std::ostream& os) const;
+
+    //false when the host doesn't count the event, its totals stay 0
+    bool isCounted(Event event) const { return groupIndex[event] >= 0; }
+    //Summed over every begin/end pair of the slice since the last clear
+    uint64_t getTotal(PerfSlice slice, Event event) const { return slices[static_cast<int>(slice)].totals[event]; }
+    uint64_t getEmulatedInstructions(PerfSlice slice) const { return slices[static_cast<int>(slice)].emulatedInstructions; }
+
+private:
+    static constexpr int nbSlices = static_cast<int>(PerfSlice::COUNT);
+
+    struct SliceTotals
+    {
+        std::array<uint64_t, NB_EVENTS> start;
+        std::array<uint64_t, NB_EVENTS> totals;
+        uint64_t count;
+        uint64_t emulatedInstructions;
+    };
+
+    void readCounters(std::array<uint64_t, NB_EVENTS>& values) const;
+
+    int groupFd;
+    std::array<int, NB_EVENTS> fds;
+    //Position of each event in the group read, -1 if the event could not be opened
+    std::array<int, NB_EVENTS> groupIndex;
+    int nbOpened;
+
+    std::array<SliceTotals, nbSlices> slices;
+};
+
+#endif
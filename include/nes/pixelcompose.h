@@ -0,0 +1,27 @@
+#ifndef PIXELCOMPOSE_H
+#define PIXELCOMPOSE_H
+
+#include <cstdint>
+
+//Implementations of the last step of a scanline, the best one the CPU runs is picked at startup
+enum class ComposeKernel
+{
+    SCALAR,
+    SSSE3, //16 pixels at a time
+    AVX2   //32 pixels at a time
+};
+
+//Priority between the background and sprite layers of a 256 pixel line, then palette lookup.
+//background : palette << 2 | color, below 16. sprites : 0x10 | palette << 2 | color, plus 0x20
+//when behind the background and 0x40 for sprite 0. colors has the 32 palette RAM entries already
+//turned into RGBA. Returns true on a sprite 0 hit.
+bool composeScanline(const uint8_t* background, const uint8_t* sprites, const uint32_t* colors, uint32_t* out);
+
+//Same with a given kernel, for benchmarks and equivalence checks. Unsupported kernels run the scalar one.
+bool composeScanline(ComposeKernel kernel, const uint8_t* background, const uint8_t* sprites, const uint32_t* colors, uint32_t* out);
+
+bool isComposeKernelSupported(ComposeKernel kernel);
+ComposeKernel bestComposeKernel();
+const char* composeKernelName(ComposeKernel kernel);
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef PPU_H
+#define PPU_H
+
+#include "chrtilecache.h"
+#include "framerenderer.h"
+#include "ppubus.h"
+#include "scanlinerenderer.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+class ByteReader;
+class ByteWriter;
+class Cpu;
+
+//2C02 picture processor, drawn a scanline at a time. It doesn't run alongside the CPU : it keeps
+//the position it has reached and catches up when something could observe it. The bus calls
+//catchUp before every register access and OAM DMA, Nes at the start of vblank (for the NMI) and
+//at the end of each frame. Each line is rendered at renderDot, so register writes made during
+//horizontal blank show from the next line, like on the console.
+//With render threads, lines are drawn by a FrameRenderer once the last visible one is reached
+//and the PPU itself only works out the sprite 0 hit and overflow flags. Skipping rendering does
+//the same without drawing anything.
+class Ppu
+{
+public:
+    static constexpr int width = 256;
+    static constexpr int height = 240;
+    static constexpr int dotsPerScanline = 341;
+    static constexpr int nbScanlines = 262;
+    static constexpr int renderDot = 256;
+
+    Ppu();
+
+    //Where vblank NMIs go
+    void setCpu(Cpu* cpu) { this->cpu = cpu; }
+
+    //addr is anything in $2000-$3FFF, the registers are mirrored every 8 bytes
+    uint8_t readRegister(uint16_t addr);
+    void writeRegister(uint16_t addr, uint8_t data);
+    //The bus copies the page written to $4014 one byte at a time
+    void writeOamDma(uint8_t data) { writeOam(data); }
+
+    //Runs every line event up to the given CPU cycle, 3 dots per cycle from dot 0 at power-up
+    void catchUp(uint64_t cycle)
+    {
+        if (cycle >= nextEventCycle) {
+            runEvents(cycle);
+        }
+    }
+
+    //0 draws each line as it's reached, the default
+    void setRenderThreads(unsigned int nbThreads);
+    unsigned int getRenderThreads() const { return frameRenderer ? frameRenderer->getNbThreads() : 0; }
+    //Returns once the render threads have drawn the last frame handed to them
+    void waitFrame()
+    {
+        if (frameRenderer) {
+            frameRenderer->wait();
+        }
+    }
+
+    //Visible lines reached while set aren't drawn, the frame keeps what was drawn before. Vblank,
+    //sprite 0 hit and sprite overflow are raised the same.
+    void setRenderSkip(bool renderSkip) { this->renderSkip = renderSkip; }
+    bool isRenderSkipped() const { return renderSkip; }
+
+    int getScanline() const { return scanline; }
+    //RGBA, 8 bits per channel, top line first. With render threads, only complete after waitFrame.
+    const uint32_t* getFrame() const { return frame.data(); }
+    //The mapper maps its CHR banks and mirroring there
+    PpuBus& getBus() { return bus; }
+
+    //Registers and memories, not the frame. The render threads must be restarted once the
+    //cartridge's state is loaded too.
+    void saveState(ByteWriter& writer) const;
+    void loadState(ByteReader& reader);
+
+private:
+    void runEvents(uint64_t cycle);
+    void renderScanline();
+    void endScanline();
+    void scheduleNextEvent() { nextEventCycle = (lineStartDot + (lineRendered ? dotsPerScanline : renderDot)) / 3; }
+
+    uint8_t readMemory(uint16_t addr);
+    void writeMemory(uint16_t addr, uint8_t data);
+    void writeOam(uint8_t data)
+    {
+        if (frameRenderer) {
+            frameRenderer->logWrite(FrameRenderer::Target::OAM, oamAddr, data);
+        }
+        memory.oam[oamAddr++] = data;
+    }
+    static unsigned int paletteIndex(uint16_t addr) { return (addr & 0x13) == 0x10 ? addr & 0x0F : addr & 0x1F; }
+
+    bool isRenderingEnabled() const { return mask & 0x18; }
+
+    void incrementY();
+    void copyX() { v = (v & ~0x041F) | (t & 0x041F); }
+    void copyY() { v = (v & ~0x7BE0) | (t & 0x7BE0); }
+
+    void logRemappedChrBanks();
+
+    Cpu* cpu;
+    PpuMemory memory;
+    ChrTileCache tileCache;
+    PpuBus bus;
+    std::unique_ptr<FrameRenderer> frameRenderer;
+
+    uint8_t ctrl;
+    uint8_t mask;
+    uint8_t status;
+    uint8_t oamAddr;
+
+    //Current and temporary VRAM addresses, fine X scroll and the $2005/$2006 write toggle
+    uint16_t v;
+    uint16_t t;
+    uint8_t fineX;
+    bool writeToggle;
+
+    uint8_t readBuffer;
+    //Last value written to a register, what write-only registers read back
+    uint8_t openBus;
+
+    int scanline;
+    //Where the PPU is : the first dot of the current line and whether it has been rendered
+    uint64_t lineStartDot;
+    bool lineRendered;
+    //CPU cycle of the next renderScanline or endScanline
+    uint64_t nextEventCycle;
+    bool renderSkip;
+
+    std::array<uint32_t, width * height> frame;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef PPUBUS_H
+#define PPUBUS_H
+
+#include "cartridgemapper.h"
+
+#include <array>
+#include <cstdint>
+
+class ChrTileCache;
+
+//$0000-$3EFF as the PPU sees it, the palette stays inside the PPU. The pattern space is eight
+//1KB CHR banks the mapper points into its CHR-ROM or CHR-RAM, the nametables four 1KB pages of
+//the PPU's nametable RAM picked by the mirroring. Every access is a shift and an indexed load,
+//mappers switching banks or mirroring only rewrite the pointers.
+class PpuBus
+{
+public:
+    static constexpr unsigned int nbChrBanks = 8;
+    static constexpr uint16_t pageSize = 0x0400;
+
+    //nametables is 4KB, four-screen cartridges use all of it. tiles is invalidated when the
+    //pattern space changes.
+    PpuBus(uint8_t* nametables, ChrTileCache* tiles);
+
+    uint8_t read(uint16_t addr) const
+    {
+        if (addr < 0x2000) {
+            return chrBanks[addr >> 10][addr & (pageSize - 1)];
+        }
+        return nametablePages[(addr >> 10) & 0x03][addr & (pageSize - 1)];
+    }
+
+    //Writes to CHR-ROM are ignored
+    void write(uint16_t addr, uint8_t data)
+    {
+        if (addr < 0x2000) {
+            writeChr(addr, data);
+        } else {
+            nametablePages[(addr >> 10) & 0x03][addr & (pageSize - 1)] = data;
+        }
+    }
+
+    //Offset into nametable RAM of a $2000-$3EFF address
+    uint16_t nametableOffset(uint16_t addr) const
+    {
+        return (nametablePages[(addr >> 10) & 0x03] - nametables) | (addr & (pageSize - 1));
+    }
+
+    //Called by the mapper. bank is 1KB and must stay valid until it's mapped again.
+    void mapChrRom(unsigned int slot, const uint8_t* bank);
+    void mapChrRam(unsigned int slot, uint8_t* bank);
+    void setMirroring(Mirroring mirroring) { setNametableLayout(nametableLayout(mirroring)); }
+    //2 bits per nametable from $2000 up, the page of nametable RAM it uses
+    void setNametableLayout(uint8_t layout);
+    uint8_t getNametableLayout() const { return layout; }
+
+    //The CHR banks mapped again since the last call, one bit per slot
+    uint8_t takeRemappedChrBanks()
+    {
+        uint8_t banks = remappedChrBanks;
+        remappedChrBanks = 0;
+        return banks;
+    }
+
+    //Single screen uses the first page
+    static uint8_t nametableLayout(Mirroring mirroring);
+
+private:
+    void mapChr(unsigned int slot, const uint8_t* bank, uint8_t* ram);
+    void writeChr(uint16_t addr, uint8_t data);
+
+    uint8_t* nametables;
+    ChrTileCache* tiles;
+
+    std::array<uint8_t*, 4> nametablePages;
+    uint8_t layout;
+
+    std::array<const uint8_t*, nbChrBanks> chrBanks;
+    //The same banks when they are CHR-RAM, null for CHR-ROM
+    std::array<uint8_t*, nbChrBanks> chrRamBanks;
+    uint8_t remappedChrBanks;
+};
+
+#endif
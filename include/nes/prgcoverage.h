@@ -0,0 +1,47 @@
+#ifndef PRGCOVERAGE_H
+#define PRGCOVERAGE_H
+
+#include "busaccess.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <string>
+#include <ostream>
+
+//One byte of BusAccess flags per PRG-ROM byte. Files written by save() from runs of the
+//same ROM can be combined with mergeFile(), flags are simply OR'ed together.
+//Immediate operands are also read by the instruction itself so they carry OPERAND and DATA.
+class PrgCoverage
+{
+public:
+    static constexpr uint32_t bankSize = 0x4000;
+
+    PrgCoverage(size_t prgSize, uint64_t prgHash);
+
+    void mark(uint32_t prgIndex, BusAccess access) { flags[prgIndex] |= static_cast<uint8_t>(access); }
+
+    uint8_t getFlags(uint32_t prgIndex) const { return flags[prgIndex]; }
+    size_t getSize() const { return flags.size(); }
+    uint64_t getPrgHash() const { return prgHash; }
+
+    void clear();
+    bool merge(const PrgCoverage& other);
+
+    bool save(const std::string& filename) const;
+    //Null if the file can't be read, errors are printed
+    static std::unique_ptr<PrgCoverage> loadFile(const std::string& filename);
+    //Fails if the file is for another ROM
+    bool mergeFile(const std::string& filename);
+
+    void writeSummary(std::ostream& os) const;
+
+private:
+    //Replaces the hash and flags, only on a fresh object : mark() relies on the size
+    bool load(const std::string& filename);
+
+    uint64_t prgHash;
+    std::vector<uint8_t> flags;
+};
+
+#endif
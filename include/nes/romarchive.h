@@ -0,0 +1,22 @@
+#ifndef ROMARCHIVE_H
+#define ROMARCHIVE_H
+
+#include "rombuffer.h"
+#include "span.h"
+
+#include <memory>
+#include <string>
+
+enum class RomCompression { NONE, GZIP, ZIP };
+
+RomCompression detectRomCompression(ByteSpan bytes);
+//.nes, .nes.gz or .zip, for the tools looking for ROMs in directories
+bool hasRomExtension(const std::string& path);
+const char* romCompressionName(RomCompression compression);
+
+//Inflates a gzip file or the first .nes entry of a zip archive in one pass, straight into
+//the buffer the mappers will use. Returns nullptr and prints why on error, or if the
+//build has no zlib.
+std::shared_ptr<const RomBuffer> decompressRom(ByteSpan compressed, RomCompression compression, const std::string& filename);
+
+#endif
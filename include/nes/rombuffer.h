@@ -0,0 +1,40 @@
+#ifndef ROMBUFFER_H
+#define ROMBUFFER_H
+
+#include "span.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Read-only bytes of a ROM file. Files are mapped rather than read, so mappers index straight
+//into the page cache and instances of the same file share its pages.
+class RomBuffer
+{
+public:
+    //Returns nullptr if the file can't be opened or is empty
+    static std::shared_ptr<const RomBuffer> mapFile(const std::string& filename);
+
+    //For ROMs built in memory
+    explicit RomBuffer(std::vector<uint8_t> bytes);
+    ~RomBuffer();
+
+    RomBuffer(const RomBuffer&) = delete;
+    RomBuffer& operator=(const RomBuffer&) = delete;
+
+    ByteSpan getBytes() const { return ByteSpan(data, size); }
+
+private:
+    RomBuffer();
+
+    const uint8_t* data;
+    size_t size;
+
+    //Set when data points into a mapping
+    void* mapping;
+    std::vector<uint8_t> owned;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef ROMCACHE_H
+#define ROMCACHE_H
+
+#include "rombuffer.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+//Process-wide table of the ROM images in use, keyed by a hash of their contents. Loading a ROM
+//that is already held by another instance returns the same RomBuffer, whatever the file name.
+//Entries are weak, an image goes away with the last mapper using it. Thread safe.
+class RomCache
+{
+public:
+    //Enabled by default. Disabling only affects later loads.
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    //Maps the file, or returns the buffer already holding the same contents
+    static std::shared_ptr<const RomBuffer> load(const std::string& filename);
+    //Same as load for a buffer built some other way
+    static std::shared_ptr<const RomBuffer> intern(std::shared_ptr<const RomBuffer> buffer);
+
+    //Images currently alive and their total size
+    static size_t getNbImages();
+    static size_t getNbBytes();
+};
+
+#endif
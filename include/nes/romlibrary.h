@@ -0,0 +1,66 @@
+#ifndef ROMLIBRARY_H
+#define ROMLIBRARY_H
+
+#include "cartridgemapper.h"
+#include "hash.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct RomLibraryEntry
+{
+    std::string path;
+    uint64_t fileSize = 0;
+    //Last write time in the filesystem clock's ticks, only compared for equality
+    int64_t modifiedTime = 0;
+
+    //False when the file has no iNES header, the hashes then cover the whole file
+    bool valid = false;
+    INesHeader header;
+
+    //Hashes of the decompressed image. CRC32C covers everything after the header, like ROM
+    //databases use, SHA-1 the whole image like the boot cache keys its snapshots.
+    uint32_t crc32c = 0;
+    Sha1Digest sha1 {};
+};
+
+struct RomScanStats
+{
+    size_t nbFiles = 0;
+    size_t nbHashed = 0;
+    size_t nbReused = 0;
+    size_t nbRemoved = 0;
+    size_t nbErrors = 0;
+    uint64_t bytesHashed = 0;
+    double seconds = 0.0;
+};
+
+//Header and hash index of a ROM collection, saved in a compact binary file. Rescans only
+//read the files whose size or modification time changed since the index was built.
+class RomLibrary
+{
+public:
+    //A missing file gives an empty library, a corrupt one fails
+    bool load(const std::string& filename);
+    bool save(const std::string& filename) const;
+
+    //Walks the files and directories in paths for .nes, .nes.gz and .zip files. Entries for
+    //files no longer found there are dropped. nbThreads = 0 uses every core.
+    RomScanStats scan(const std::vector<std::string>& paths, unsigned int nbThreads = 0);
+
+    const std::vector<RomLibraryEntry>& getEntries() const { return entries; }
+
+    const RomLibraryEntry* findByPath(const std::string& path) const;
+    const RomLibraryEntry* findBySha1(const Sha1Digest& sha1) const;
+    std::vector<const RomLibraryEntry*> findByCrc32c(uint32_t crc) const;
+
+private:
+    std::vector<RomLibraryEntry> entries;
+    std::unordered_map<std::string, size_t> pathIndex;
+
+    void rebuildPathIndex();
+};
+
+#endif
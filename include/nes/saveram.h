@@ -0,0 +1,66 @@
+#ifndef SAVERAM_H
+#define SAVERAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ByteReader;
+class ByteWriter;
+
+//Cartridge RAM, optionally backed by a battery save file. A file-backed SaveRam is a shared
+//mapping of the file : writes land in the page cache and survive a crash, flush only asks the
+//kernel to write back the pages touched since the last flush.
+class SaveRam
+{
+public:
+    //Enabled by default. Tools running many instances of the same ROM turn it off so they
+    //don't write over each other's saves. Only affects later loads.
+    static void setFilesEnabled(bool enabled);
+    static bool areFilesEnabled();
+
+    //In memory, filled with 0xFF
+    explicit SaveRam(size_t size);
+    ~SaveRam();
+
+    SaveRam(const SaveRam&) = delete;
+    SaveRam& operator=(const SaveRam&) = delete;
+
+    //Switches to the file, created or extended with 0xFF. The current contents are dropped.
+    //Returns false and stays in memory if the file can't be mapped.
+    bool mapFile(const std::string& filename);
+
+    uint8_t read(size_t offset) const { return bytes[offset]; }
+    void write(size_t offset, uint8_t data)
+    {
+        bytes[offset] = data;
+        dirtyPages |= uint64_t(1) << (offset >> dirtyPageShift);
+    }
+
+    //Starts writing the dirty pages back. wait blocks until they are on disk.
+    void flush(bool wait = false);
+
+    //Loading marks every page dirty, a file-backed SaveRam writes the snapshot to its file
+    void saveState(ByteWriter& writer) const;
+    void loadState(ByteReader& reader);
+
+    size_t getSize() const { return size; }
+    bool isFileBacked() const { return !filename.empty(); }
+    const std::string& getFilename() const { return filename; }
+
+private:
+    //4KB per dirty bit, so up to 256KB of RAM
+    static constexpr int dirtyPageShift = 12;
+
+    uint8_t* bytes;
+    size_t size;
+    uint64_t dirtyPages;
+
+    std::string filename;
+    //Set when bytes points into a mapping
+    void* mapping;
+    std::vector<uint8_t> owned;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SCANLINERENDERER_H
+#define SCANLINERENDERER_H
+
+#include "chrtilecache.h"
+
+#include <array>
+#include <cstdint>
+
+//Everything a line is drawn from besides the pattern tables
+struct PpuMemory
+{
+    //Four pages so four-screen cartridges work, the other mirrorings only use the first two.
+    //Which page each nametable uses is up to the PPU bus.
+    std::array<uint8_t, 0x1000> nametables;
+    std::array<uint8_t, 32> palette;
+    std::array<uint8_t, 256> oam;
+};
+
+//The registers a visible line is drawn with, as they are at its render dot
+struct PpuLineRegisters
+{
+    uint16_t v;
+    uint8_t fineX;
+    uint8_t ctrl;
+    uint8_t mask;
+    //PpuBus::getNametableLayout
+    uint8_t nametableLayout;
+};
+
+//PPUSTATUS bits set while drawing
+constexpr uint8_t spriteOverflowFlag = 0x20;
+constexpr uint8_t sprite0HitFlag = 0x40;
+
+//RGBA of a palette RAM value
+uint32_t paletteColor(uint8_t color);
+
+//Draws visible line scanline, 256 RGBA pixels. Returns the sprite overflow and sprite 0 hit
+//flags the line raises.
+uint8_t drawScanline(const PpuMemory& memory, ChrTileCache& tiles,
+                     const PpuLineRegisters& registers, int scanline, uint32_t* out);
+
+//The same flags without drawing. Lines without sprite 0, or once the hit is already set, only
+//count their sprites. The hit is tested on masks of the opaque pixels in sprite 0's 8 columns.
+uint8_t scanlineStatus(const PpuMemory& memory, ChrTileCache& tiles,
+                       const PpuLineRegisters& registers, int scanline, bool sprite0Hit);
+
+#endif
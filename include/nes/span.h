@@ -0,0 +1,38 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+//Pointer and length into memory owned by someone else, a C++17 stand-in for std::span
+template<class T>
+class Span
+{
+public:
+    Span() : ptr(nullptr), count(0) {}
+    Span(T* ptr, size_t count) : ptr(ptr), count(count) {}
+
+    T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T& operator[](size_t index) const { return ptr[index]; }
+
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + count; }
+
+    Span subspan(size_t offset, size_t length) const
+    {
+        assert(offset + length <= count);
+        return Span(ptr + offset, length);
+    }
+
+private:
+    T* ptr;
+    size_t count;
+};
+
+using ByteSpan = Span<const uint8_t>;
+
+#endif
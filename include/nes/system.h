@@ -0,0 +1,65 @@
+#ifndef SYSTEM_H
+#define SYSTEM_H
+
+#include "cpu.h"
+#include "cpuram.h"
+#include "cpubus.h"
+#include "cartridgemapper.h"
+#include "ppu.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//What Nes needs from a System without knowing its mapper. These are called per frame, not per access.
+class ISystem
+{
+public:
+    virtual ~ISystem() {}
+
+    virtual Cpu& getCpu() = 0;
+    virtual CpuBus& getBus() = 0;
+    virtual Ppu& getPpu() = 0;
+    virtual CartridgeMapper* getCartridge() = 0;
+
+    //Reads RAM or cartridge space without any side effect on the emulation
+    virtual uint8_t peek(uint16_t addr) = 0;
+
+    //CPU, bus, RAM, PPU and cartridge, in that order
+    virtual void saveState(ByteWriter& writer) const = 0;
+    virtual void loadState(ByteReader& reader) = 0;
+};
+
+//CPU, RAM and bus specialized on the cartridge mapper, so the CPU reaches the mapper
+//through direct calls. Built by loadSystemFromFile once the mapper is known.
+template<class Mapper>
+class System final : public ISystem
+{
+public:
+    System(std::unique_ptr<Mapper> cartridge, CpuAccuracy accuracy, const std::string& cpuLogFilename);
+
+    Cpu& getCpu() override { return *cpu; }
+    CpuBus& getBus() override { return cpuBus; }
+    Ppu& getPpu() override { return ppu; }
+    CartridgeMapper* getCartridge() override { return cartridge.get(); }
+
+    uint8_t peek(uint16_t addr) override;
+
+    void saveState(ByteWriter& writer) const override;
+    void loadState(ByteReader& reader) override;
+
+private:
+    std::unique_ptr<Mapper> cartridge;
+    Ppu ppu;
+    CpuRam cpuRam;
+    MappedCpuBus<Mapper> cpuBus;
+    std::unique_ptr<Cpu> cpu;
+};
+
+//Picks the System instantiation matching the file's mapper. Returns nullptr on error.
+//stats, when given, receives the file loading times.
+std::unique_ptr<ISystem> loadSystemFromFile(const std::string& filename, CpuAccuracy accuracy,
+                                            const std::string& cpuLogFilename, bool verbose = true,
+                                            CartridgeLoadStats* stats = nullptr);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+
+//Scoped timing zones recorded into per-thread buffers and written as Chrome/Perfetto trace JSON.
+//TRACE_ZONE() compiles to nothing unless CRNES_TRACING is defined, and only records once
+//Tracer::setEnabled(true) has been called.
+class Tracer
+{
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    static uint64_t now();
+    static void record(const char* name, uint64_t start, uint64_t end);
+    static void setThreadName(const std::string& name);
+
+    //Buffers are read without locking, call this while no other thread is recording
+    static bool writeChromeTrace(const std::string& filename);
+    static void clear();
+};
+
+class TraceZone
+{
+public:
+    explicit TraceZone(const char* name)
+        : name(name), active(Tracer::isEnabled()), start(active ? Tracer::now() : 0)
+    {
+
+    }
+
+    ~TraceZone()
+    {
+        if (active) {
+            Tracer::record(name, start, Tracer::now());
+        }
+    }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* name;
+    bool active;
+    uint64_t start;
+};
+
+#define CRNES_TRACE_CONCAT_IMPL(a, b) a##b
+#define CRNES_TRACE_CONCAT(a, b) CRNES_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef CRNES_TRACING
+#define TRACE_ZONE(name) TraceZone CRNES_TRACE_CONCAT(traceZone, __LINE__)(name)
+#else
+#define TRACE_ZONE(name)
+#endif
+
+#endif
@@ -1,41 +1,102 @@
 #include <QApplication>
 #include <QDebug>
+#include <QTimer>
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <vector>
 #include <array>
 
 #include "mainwindow.h"
-#include "cpu.h"
-#include "cpuram.h"
-#include "cpubus.h"
-#include "cartridgemapper.h"
+#include "bootcache.h"
+#include "nes.h"
+#include "perfcounters.h"
+#include "trace.h"
 
 int main(int argc, char** argv)
 {
     QApplication a(argc, argv);
 
+    //--trace records instrumentation zones (CRNES_TRACING builds) and writes them to crnes_trace.json on exit
+    bool traceMode = a.arguments().contains("--trace");
+    Tracer::setEnabled(traceMode);
+    Tracer::setThreadName("main");
+
     qDebug() << "Hello, world";
 
     MainWindow window;
     window.show();
 
-    Cpu cpu;
-    CpuRam cpuRam;
+    //Later launches resume from a snapshot taken after the first 60 frames, --no-boot-cache always boots from power-up
+    if (!a.arguments().contains("--no-boot-cache")) {
+        BootCache::setDirectory("crnes-cache");
+    }
+
+    Nes nes;
+
+    //--render-threads N draws the visible lines on N threads at the end of each frame
+    int renderThreadsArg = a.arguments().indexOf("--render-threads");
+    if (renderThreadsArg >= 0 && renderThreadsArg + 1 < a.arguments().size()) {
+        nes.setRenderThreads(a.arguments().at(renderThreadsArg + 1).toUInt());
+    }
+
+    //--fast-forward N runs N frames per tick, only the last one is drawn and shown
+    unsigned int framesPerTick = 1;
+    int fastForwardArg = a.arguments().indexOf("--fast-forward");
+    if (fastForwardArg >= 0 && fastForwardArg + 1 < a.arguments().size()) {
+        framesPerTick = std::max(1u, a.arguments().at(fastForwardArg + 1).toUInt());
+    }
 
-    CpuBus cpuBus(&cpuRam);
-    cpu.setMediator(&cpuBus);
+    if (!nes.loadCartridge("testRoms/instr_misc/rom_singles/03-dummy_reads.nes")) {
+        return 1;
+    }
 
-    CartridgeMapper* cartridge = loadCartridgeMapperFromFile("testRoms/instr_misc/rom_singles/03-dummy_reads.nes");
-    cpuBus.setCartridge(cartridge);
+#ifdef CRNES_BUS_STATS
+    std::ofstream heatmap("bus_heatmap.csv");
+    nes.getBus().getStats().setHeatmapOutput(&heatmap);
+#endif
 
-    while (true) {
-        cpu.tick();
+    //--perf reads host hardware counters around every frame and prints them on exit
+    bool perfMode = a.arguments().contains("--perf");
+    PerfCounters* perfCounters = nullptr;
+    if (perfMode) {
+        perfCounters = new PerfCounters();
+        nes.setPerfCounters(perfCounters);
+        window.setPerfCounters(perfCounters);
     }
 
+    QTimer frameTimer;
+    QObject::connect(&frameTimer, &QTimer::timeout, [&nes, &window, framesPerTick]() {
+        TRACE_ZONE("Frame timer");
+        for (unsigned int frame = 1; frame < framesPerTick; ++frame) {
+            nes.runFrame(false);
+        }
+        nes.runFrame();
+        window.setFrame(nes.getPpu().getFrame());
+        window.update();
+    });
+    frameTimer.start(16);
+
+    int result = a.exec();
+
+    if (perfCounters) {
+        perfCounters->writeReport(std::cout);
+        window.setPerfCounters(nullptr);
+        delete perfCounters;
+    }
+
+    if (traceMode) {
+        Tracer::writeChromeTrace("crnes_trace.json");
+    }
+
+#ifdef CRNES_BUS_STATS
+    nes.getBus().getStats().writeSummary(std::cout);
+#endif
+
     std::cout << "Done!" << std::endl;
 
-    return a.exec();
+    return result;
 }
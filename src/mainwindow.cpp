@@ -1,13 +1,16 @@
 #include "mainwindow.h"
+#include "trace.h"
 
 #include <GL/gl.h>
 #include <QDebug>
 
+#include <algorithm>
 #include <iostream>
 
 MainWindow::MainWindow()
+    : perfCounters(nullptr)
 {
-    pixels.fill(128);
+    pixels.fill(0xFF808080);
 }
 
 MainWindow::~MainWindow()
@@ -15,6 +18,13 @@ MainWindow::~MainWindow()
 
 }
 
+void MainWindow::setFrame(const uint32_t* frame)
+{
+    for (int y = 0; y < nesHeight; ++y) {
+        std::copy(frame + y * nesWidth, frame + (y + 1) * nesWidth, pixels.begin() + (nesHeight - 1 - y) * nesWidth);
+    }
+}
+
 void MainWindow::initializeGL()
 {
     QOpenGLFunctions* f = QOpenGLContext::currentContext()->functions();
@@ -35,8 +45,18 @@ void MainWindow::resizeGL(int w, int h)
 
 void MainWindow::paintGL()
 {
+    TRACE_ZONE("MainWindow::paintGL");
+
+    if (perfCounters) {
+        perfCounters->begin(PerfSlice::PRESENT);
+    }
+
     QOpenGLFunctions* f = QOpenGLContext::currentContext()->functions();
     f->glClear(GL_COLOR_BUFFER_BIT);
 
-    glDrawPixels(nesWidth, nesHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    glDrawPixels(nesWidth, nesHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    if (perfCounters) {
+        perfCounters->end(PerfSlice::PRESENT);
+    }
 }
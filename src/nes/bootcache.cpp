@@ -0,0 +1,95 @@
+#include "bootcache.h"
+#include "hash.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+
+namespace
+{
+std::mutex directoryMutex;
+std::string cacheDirectory;
+std::atomic<unsigned int> warmupFrames(60);
+
+std::string snapshotFilename(const std::string& directory, ByteSpan rom, CpuAccuracy accuracy)
+{
+    Sha1Digest digest = sha1(rom.data(), rom.size());
+
+    return (std::filesystem::path(directory) / (toHex(digest.data(), digest.size()) + "-" + cpuAccuracyName(accuracy)
+                                                + "-" + std::to_string(BootCache::getWarmupFrames()) + ".state")).string();
+}
+}
+
+void BootCache::setDirectory(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(directoryMutex);
+    cacheDirectory = directory;
+}
+
+std::string BootCache::getDirectory()
+{
+    std::lock_guard<std::mutex> lock(directoryMutex);
+    return cacheDirectory;
+}
+
+bool BootCache::isEnabled()
+{
+    return !getDirectory().empty();
+}
+
+void BootCache::setWarmupFrames(unsigned int frames)
+{
+    warmupFrames.store(frames, std::memory_order_relaxed);
+}
+
+unsigned int BootCache::getWarmupFrames()
+{
+    return warmupFrames.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<const RomBuffer> BootCache::load(ByteSpan rom, CpuAccuracy accuracy)
+{
+    std::string directory = getDirectory();
+    if (directory.empty()) {
+        return nullptr;
+    }
+
+    return RomBuffer::mapFile(snapshotFilename(directory, rom, accuracy));
+}
+
+bool BootCache::store(ByteSpan rom, CpuAccuracy accuracy, const std::vector<uint8_t>& snapshot)
+{
+    std::string directory = getDirectory();
+    if (directory.empty()) {
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    std::string filename = snapshotFilename(directory, rom, accuracy);
+    //Instances booting the same ROM at once each write their own file, the last rename wins
+    std::string temporary = filename + ".tmp" + std::to_string(std::random_device()());
+
+    {
+        std::ofstream file(temporary, std::ios_base::binary | std::ios_base::trunc);
+        file.write(reinterpret_cast<const char*>(snapshot.data()), snapshot.size());
+
+        if (!file) {
+            std::cout << "Cannot write boot snapshot : " << temporary << std::endl;
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary, filename, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#include "busstats.h"
+
+#include <iomanip>
+
+namespace
+{
+const char* const regionNames[] = {"RAM", "PPU", "APU/IO", "Cartridge"};
+const char* const kindNames[] = {"Opcode", "Operand", "Data", "Dummy"};
+}
+
+BusStats::BusStats()
+    : heatmapOutput(nullptr), frameCount(0)
+{
+    clear();
+}
+
+void BusStats::clear()
+{
+    for (auto& region : reads) {
+        region.fill(0);
+    }
+    writes.fill(0);
+    pageReads.fill(0);
+    pageWrites.fill(0);
+    frameCount = 0;
+}
+
+void BusStats::endFrame()
+{
+    //One CSV line per frame and direction : frame,r|w,page $00 count,...,page $FF count
+    if (heatmapOutput) {
+        std::ostream& os = *heatmapOutput;
+
+        os << frameCount << ",r";
+        for (auto count : pageReads) {
+            os << "," << count;
+        }
+        os << "\n" << frameCount << ",w";
+        for (auto count : pageWrites) {
+            os << "," << count;
+        }
+        os << "\n";
+    }
+
+    pageReads.fill(0);
+    pageWrites.fill(0);
+    ++frameCount;
+}
+
+void BusStats::writeSummary(std::ostream& os) const
+{
+    os << std::left << std::setw(10) << "Region";
+    for (auto kindName : kindNames) {
+        os << std::right << std::setw(14) << kindName;
+    }
+    os << std::setw(14) << "Write" << "\n";
+
+    for (int region = 0; region < nbRegions; ++region) {
+        os << std::left << std::setw(10) << regionNames[region] << std::right;
+        for (int kind = 0; kind < nbKinds; ++kind) {
+            os << std::setw(14) << reads[region][kind];
+        }
+        os << std::setw(14) << writes[region] << "\n";
+    }
+}
@@ -0,0 +1,58 @@
+#include "chrtilecache.h"
+#include "ppubus.h"
+
+ChrTileCache::ChrTileCache(const PpuBus* bus)
+    : bus(bus), patterns(nullptr), nbDecoded(0)
+{
+    valid.fill(false);
+}
+
+ChrTileCache::ChrTileCache(const uint8_t* patterns)
+    : bus(nullptr), patterns(patterns), nbDecoded(0)
+{
+    valid.fill(false);
+}
+
+void ChrTileCache::invalidate(uint16_t addr, uint16_t size)
+{
+    if (size == 0) {
+        return;
+    }
+
+    unsigned int first = addr >> 4;
+    unsigned int last = (addr + size - 1u) >> 4;
+
+    for (unsigned int tile = first; tile <= last; ++tile) {
+        valid[tile & (nbTiles - 1)] = false;
+    }
+}
+
+void ChrTileCache::decodeAll()
+{
+    for (unsigned int tile = 0; tile < nbTiles; ++tile) {
+        if (!valid[tile]) {
+            decode(tile);
+        }
+    }
+}
+
+void ChrTileCache::decode(unsigned int tile)
+{
+    uint8_t* pixels = tiles[tile].data();
+    uint16_t base = tile << 4;
+
+    //The low bitplane is the first 8 bytes, the high one the next 8. Bit 7 is the leftmost pixel.
+    for (unsigned int row = 0; row < 8; ++row) {
+        uint8_t low = patterns ? patterns[base + row] : bus->read(base + row);
+        uint8_t high = patterns ? patterns[base + row + 8] : bus->read(base + row + 8);
+        opaqueMasks[tile][row] = low | high;
+
+        for (unsigned int x = 0; x < 8; ++x) {
+            unsigned int bit = 7 - x;
+            pixels[row * 8 + x] = ((low >> bit) & 1) | (((high >> bit) & 1) << 1);
+        }
+    }
+
+    valid[tile] = true;
+    ++nbDecoded;
+}
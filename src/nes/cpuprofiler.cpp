@@ -0,0 +1,252 @@
+#include "cpuprofiler.h"
+#include "optable.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace
+{
+std::string hexAddr(uint16_t addr)
+{
+    std::ostringstream oss;
+    oss << std::uppercase << std::hex << std::setfill('0') << std::setw(4) << addr;
+    return oss.str();
+}
+
+std::string functionName(uint16_t entry, bool root)
+{
+    return root ? "root" : "sub_" + hexAddr(entry);
+}
+}
+
+CpuProfiler::CpuProfiler(unsigned int sampleInterval)
+    : sampleInterval(sampleInterval > 0 ? sampleInterval : 1), nextSample(0), totalSamples(0), pcSamples(0x10000, 0), droppedFrames(0)
+{
+    clear();
+}
+
+void CpuProfiler::clear()
+{
+    nextSample = 0;
+    totalSamples = 0;
+    opcodeCounters.fill({0, 0});
+    addrModeCounters.fill({0, 0});
+    std::fill(pcSamples.begin(), pcSamples.end(), 0);
+    callStack.assign(1, {0, 0});
+    droppedFrames = 0;
+    stackSamples.clear();
+    callCounts.clear();
+}
+
+void CpuProfiler::onReset(uint16_t PC, uint64_t cycle)
+{
+    callStack.assign(1, {PC, PC});
+    droppedFrames = 0;
+    nextSample = cycle + sampleInterval;
+}
+
+void CpuProfiler::onInstruction(uint16_t PC, uint8_t opId, const Opcode& opcode, uint64_t startCycle, uint64_t endCycle, uint16_t nextPC)
+{
+    uint64_t cycles = endCycle - startCycle;
+
+    Counter& opCounter = opcodeCounters[opId];
+    ++opCounter.count;
+    opCounter.cycles += cycles;
+
+    Counter& modeCounter = addrModeCounters[std::min(static_cast<int>(opcode.addrMode), static_cast<int>(AddrMode::BAD_MODE))];
+    ++modeCounter.count;
+    modeCounter.cycles += cycles;
+
+    //Attached in the middle of a run : start sampling from here
+    if (nextSample == 0) {
+        nextSample = startCycle + sampleInterval;
+    }
+
+    //Samples are attributed before the stack is updated so a JSR is charged to its caller
+    if (endCycle >= nextSample) {
+        uint64_t nbSamples = (endCycle - nextSample) / sampleInterval + 1;
+        nextSample += nbSamples * sampleInterval;
+        takeSamples(PC, nbSamples);
+    }
+
+    switch (opcode.op) {
+    case Op::JSR:
+    case Op::BRK:
+        pushFrame(PC, nextPC);
+        break;
+    case Op::RTS:
+    case Op::RTI:
+        //Games often pop return addresses by hand, never unwind the root frame
+        if (droppedFrames > 0) {
+            --droppedFrames;
+        } else if (callStack.size() > 1) {
+            callStack.pop_back();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void CpuProfiler::onInterrupt(uint16_t PC, uint16_t handler)
+{
+    pushFrame(PC, handler);
+}
+
+void CpuProfiler::pushFrame(uint16_t callSite, uint16_t entry)
+{
+    ++callCounts[(static_cast<uint32_t>(callSite) << 16) | entry];
+    if (callStack.size() < maxStackDepth) {
+        callStack.push_back({entry, callSite});
+    } else {
+        ++droppedFrames;
+    }
+}
+
+void CpuProfiler::takeSamples(uint16_t PC, uint64_t nbSamples)
+{
+    pcSamples[PC] += nbSamples;
+    totalSamples += nbSamples;
+
+    std::vector<uint16_t> key;
+    key.reserve(callStack.size() * 2 + 1);
+    for (const auto& frame : callStack) {
+        key.push_back(frame.entry);
+        key.push_back(frame.callSite);
+    }
+    key.push_back(PC);
+
+    stackSamples[key] += nbSamples;
+}
+
+void CpuProfiler::writeReport(std::ostream& os, unsigned int nbHotPcs) const
+{
+    uint64_t totalInstructions = 0;
+    uint64_t totalCycles = 0;
+    for (const auto& counter : opcodeCounters) {
+        totalInstructions += counter.count;
+        totalCycles += counter.cycles;
+    }
+
+    os << "Instructions : " << totalInstructions
+       << "\nCycles : " << totalCycles
+       << "\nSamples : " << totalSamples << " (every " << sampleInterval << " cycles)\n";
+
+    std::vector<std::pair<uint64_t, uint16_t>> hotPcs;
+    for (unsigned int pc = 0; pc < pcSamples.size(); ++pc) {
+        if (pcSamples[pc] > 0) {
+            hotPcs.push_back({pcSamples[pc], static_cast<uint16_t>(pc)});
+        }
+    }
+    std::sort(hotPcs.rbegin(), hotPcs.rend());
+    if (hotPcs.size() > nbHotPcs) {
+        hotPcs.resize(nbHotPcs);
+    }
+
+    os << "\nHot PCs\n";
+    for (const auto& hotPc : hotPcs) {
+        os << "  $" << hexAddr(hotPc.second) << "  " << std::setw(10) << hotPc.first
+           << "  " << std::fixed << std::setprecision(2) << std::setw(6) << (100.0 * hotPc.first / totalSamples) << "%\n";
+    }
+
+    std::vector<std::pair<uint64_t, int>> opcodesByCycles;
+    for (int opId = 0; opId < 0x100; ++opId) {
+        if (opcodeCounters[opId].count > 0) {
+            opcodesByCycles.push_back({opcodeCounters[opId].cycles, opId});
+        }
+    }
+    std::sort(opcodesByCycles.rbegin(), opcodesByCycles.rend());
+
+    os << "\nOpcodes (by cycles)\n";
+    for (const auto& entry : opcodesByCycles) {
+        const Counter& counter = opcodeCounters[entry.second];
+        const Opcode& opcode = opTable[entry.second];
+        os << "  $" << std::uppercase << std::hex << std::setfill('0') << std::setw(2) << entry.second
+           << std::dec << std::setfill(' ') << " " << opcode.mnemonic << " " << std::left << std::setw(14) << addrModeName(opcode.addrMode)
+           << std::right << std::setw(12) << counter.count
+           << std::setw(14) << counter.cycles
+           << "  " << std::fixed << std::setprecision(2) << static_cast<double>(counter.cycles) / counter.count << " cyc/op"
+           << " (documented " << static_cast<int>(opcode.cycles) << (opcode.pageCrossPenalty ? "+" : "") << ")\n";
+    }
+
+    os << "\nAddressing modes (by cycles)\n";
+    for (int mode = 0; mode < static_cast<int>(addrModeCounters.size()); ++mode) {
+        const Counter& counter = addrModeCounters[mode];
+        if (counter.count == 0) {
+            continue;
+        }
+        os << "  " << std::left << std::setw(14) << addrModeName(static_cast<AddrMode>(mode)) << std::right
+           << std::setw(12) << counter.count << std::setw(14) << counter.cycles << "\n";
+    }
+}
+
+void CpuProfiler::writeFoldedStacks(std::ostream& os) const
+{
+    for (const auto& entry : stackSamples) {
+        const std::vector<uint16_t>& key = entry.first;
+        unsigned int nbFrames = (key.size() - 1) / 2;
+
+        for (unsigned int i = 0; i < nbFrames; ++i) {
+            os << (i > 0 ? ";" : "") << functionName(key[i * 2], i == 0);
+        }
+        os << ";$" << hexAddr(key.back()) << " " << entry.second << "\n";
+    }
+}
+
+void CpuProfiler::writeCallgrind(std::ostream& os) const
+{
+    //Functions are keyed by their entry address, the root frame gets 0x10000
+    struct FunctionCost
+    {
+        std::map<uint16_t, uint64_t> self;
+        std::map<std::pair<uint16_t, uint32_t>, uint64_t> inclusive; //(callSite, callee) -> samples
+    };
+    std::map<uint32_t, FunctionCost> functions;
+
+    for (const auto& entry : stackSamples) {
+        const std::vector<uint16_t>& key = entry.first;
+        unsigned int nbFrames = (key.size() - 1) / 2;
+
+        auto functionKey = [&key](unsigned int frame) -> uint32_t {
+            return frame == 0 ? 0x10000 : key[frame * 2];
+        };
+
+        functions[functionKey(nbFrames - 1)].self[key.back()] += entry.second;
+
+        for (unsigned int i = 0; i + 1 < nbFrames; ++i) {
+            uint16_t callSite = key[(i + 1) * 2 + 1];
+            functions[functionKey(i)].inclusive[{callSite, functionKey(i + 1)}] += entry.second;
+        }
+    }
+
+    os << "# callgrind format\n"
+       << "version: 1\n"
+       << "creator: CrNES\n"
+       << "positions: instr\n"
+       << "events: Samples\n"
+       << "summary: " << totalSamples << "\n";
+
+    os << std::nouppercase << std::hex;
+    for (const auto& function : functions) {
+        os << "\nfn=" << functionName(function.first, function.first == 0x10000) << "\n";
+
+        for (const auto& self : function.second.self) {
+            os << "0x" << self.first << " " << std::dec << self.second << std::hex << "\n";
+        }
+
+        for (const auto& call : function.second.inclusive) {
+            uint16_t callSite = call.first.first;
+            uint16_t callee = static_cast<uint16_t>(call.first.second);
+            auto callCount = callCounts.find((static_cast<uint32_t>(callSite) << 16) | callee);
+
+            os << "cfn=" << functionName(callee, call.first.second == 0x10000) << "\n"
+               << "calls=" << std::dec << (callCount != callCounts.end() ? callCount->second : 1) << std::hex
+               << " 0x" << callee << "\n"
+               << "0x" << callSite << " " << std::dec << call.second << std::hex << "\n";
+        }
+    }
+    os << std::dec;
+}
@@ -1,6 +1,5 @@
 #include "cpuram.h"
-
-#include <cassert>
+#include "bytestream.h"
 
 CpuRam::CpuRam()
 {
@@ -9,14 +8,12 @@ CpuRam::CpuRam()
     mem.fill(0xFF);
 }
 
-uint8_t CpuRam::read(uint16_t addr)
+void CpuRam::saveState(ByteWriter& writer) const
 {
-    assert(addr < 0x0800);
-    return mem[addr];
+    writer.putBytes(mem.data(), mem.size());
 }
 
-void CpuRam::write(uint16_t addr, uint8_t data)
+void CpuRam::loadState(ByteReader& reader)
 {
-    assert(addr < 0x0800);
-    mem[addr] = data;
+    reader.getBytes(mem.data(), mem.size());
 }
@@ -0,0 +1,62 @@
+#include "disassembler.h"
+#include "optable.h"
+
+#include <cstdio>
+
+std::string disassembleOperand(const uint8_t* bytes, uint16_t PC)
+{
+    const Opcode& opcode = opTable[bytes[0]];
+    unsigned int word = opcode.bytes == 3 ? bytes[1] | (bytes[2] << 8) : 0;
+    char text[16] = "";
+
+    switch (opcode.addrMode) {
+    case AddrMode::ACCUMULATOR:
+        std::snprintf(text, sizeof(text), "A");
+        break;
+    case AddrMode::IMMEDIATE:
+        std::snprintf(text, sizeof(text), "#$%02X", bytes[1]);
+        break;
+    case AddrMode::ZERO_PAGE:
+        std::snprintf(text, sizeof(text), "$%02X", bytes[1]);
+        break;
+    case AddrMode::ZERO_PAGE_X:
+        std::snprintf(text, sizeof(text), "$%02X,X", bytes[1]);
+        break;
+    case AddrMode::ZERO_PAGE_Y:
+        std::snprintf(text, sizeof(text), "$%02X,Y", bytes[1]);
+        break;
+    case AddrMode::RELATIVE:
+        std::snprintf(text, sizeof(text), "$%04X", (PC + 2 + static_cast<int8_t>(bytes[1])) & 0xFFFF);
+        break;
+    case AddrMode::ABSOLUTE:
+        std::snprintf(text, sizeof(text), "$%04X", word);
+        break;
+    case AddrMode::ABSOLUTE_X:
+        std::snprintf(text, sizeof(text), "$%04X,X", word);
+        break;
+    case AddrMode::ABSOLUTE_Y:
+        std::snprintf(text, sizeof(text), "$%04X,Y", word);
+        break;
+    case AddrMode::INDIRECT:
+        std::snprintf(text, sizeof(text), "($%04X)", word);
+        break;
+    case AddrMode::INDEXED_INDIRECT:
+        std::snprintf(text, sizeof(text), "($%02X,X)", bytes[1]);
+        break;
+    case AddrMode::INDIRECT_INDEXED:
+        std::snprintf(text, sizeof(text), "($%02X),Y", bytes[1]);
+        break;
+    default:
+        break;
+    }
+
+    return text;
+}
+
+std::string disassemble(const uint8_t* bytes, uint16_t PC)
+{
+    std::string operand = disassembleOperand(bytes, PC);
+    std::string mnemonic = opTable[bytes[0]].mnemonic;
+
+    return operand.empty() ? mnemonic : mnemonic + " " + operand;
+}
@@ -0,0 +1,176 @@
+#include "framerenderer.h"
+#include "ppu.h"
+#include "trace.h"
+
+#include <algorithm>
+
+FrameRenderer::FrameRenderer(const PpuBus& bus, const PpuMemory& memory, unsigned int nbThreads)
+    : memory(memory), patterns(), tiles(patterns.data()), nextLine(0),
+      firstWrite(0), frame(nullptr), inFlight(false), generation(0), quit(false), nbChunks(0), nextChunk(0), nbChunksLeft(0)
+{
+    for (unsigned int addr = 0; addr < patterns.size(); ++addr) {
+        patterns[addr] = bus.read(addr);
+    }
+    logged.fill(false);
+
+    for (unsigned int i = 0; i < std::max(1u, nbThreads); ++i) {
+        workers.emplace_back([this, i]() {
+            Tracer::setThreadName("render " + std::to_string(i));
+            work();
+        });
+    }
+}
+
+FrameRenderer::~FrameRenderer()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeUp.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void FrameRenderer::logLine(int scanline, const PpuLineRegisters& lineRegisters)
+{
+    registers[scanline] = lineRegisters;
+    logged[scanline] = true;
+    nextLine = scanline + 1;
+}
+
+void FrameRenderer::renderFrame(uint32_t* frame)
+{
+    wait();
+
+    drawing.log.swap(log);
+    log.clear();
+    drawing.registers = registers;
+    drawing.logged = logged;
+    logged.fill(false);
+    nextLine = 0;
+    this->frame = frame;
+
+    //Writes made before the first line apply to all of them
+    bool patternsWritten = false;
+    for (firstWrite = 0; firstWrite < drawing.log.size() && drawing.log[firstWrite].line == 0; ++firstWrite) {
+        apply(drawing.log[firstWrite], memory);
+    }
+    for (size_t i = firstWrite; i < drawing.log.size(); ++i) {
+        patternsWritten = patternsWritten || drawing.log[i].target == Target::PATTERNS;
+    }
+
+    //The workers share the tile cache, it can only change under a single one
+    if (!patternsWritten) {
+        tiles.decodeAll();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nbChunks = patternsWritten ? 1 : workers.size();
+        nbChunksLeft = nbChunks;
+        ++generation;
+        nextChunk = generation << 32;
+    }
+    inFlight = true;
+    wakeUp.notify_all();
+}
+
+void FrameRenderer::wait()
+{
+    if (!inFlight) {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return nbChunksLeft == 0; });
+    }
+    inFlight = false;
+
+    //Catch the copies up with the end of the frame
+    for (size_t i = firstWrite; i < drawing.log.size(); ++i) {
+        apply(drawing.log[i], memory);
+    }
+}
+
+void FrameRenderer::work()
+{
+    uint64_t seenGeneration = 0;
+
+    for (;;) {
+        unsigned int chunks;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this, seenGeneration]() { return quit || generation != seenGeneration; });
+            if (quit) {
+                return;
+            }
+            seenGeneration = generation;
+            chunks = nbChunks;
+        }
+
+        //Tickets carry the generation, a worker still finishing the previous frame must not take
+        //(and lose) a chunk of the next one
+        uint64_t ticket = nextChunk.load();
+        for (;;) {
+            unsigned int chunk = ticket & 0xFFFFFFFF;
+            if ((ticket >> 32) != (seenGeneration & 0xFFFFFFFF) || chunk >= chunks) {
+                break;
+            }
+            if (!nextChunk.compare_exchange_weak(ticket, ticket + 1)) {
+                continue;
+            }
+
+            drawLines(chunk * nbLines / chunks, (chunk + 1) * nbLines / chunks);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--nbChunksLeft == 0) {
+                done.notify_one();
+            }
+            ticket = nextChunk.load();
+        }
+    }
+}
+
+void FrameRenderer::drawLines(int first, int last)
+{
+    TRACE_ZONE("FrameRenderer::drawLines");
+
+    PpuMemory lineMemory = memory;
+    size_t write = firstWrite;
+
+    for (int line = first; line < last; ++line) {
+        for (; write < drawing.log.size() && drawing.log[write].line <= line; ++write) {
+            apply(drawing.log[write], lineMemory);
+        }
+
+        if (drawing.logged[line]) {
+            drawScanline(lineMemory, tiles, drawing.registers[line], line, frame + line * Ppu::width);
+        }
+    }
+}
+
+void FrameRenderer::apply(const Write& write, PpuMemory& target)
+{
+    switch (write.target) {
+    case Target::PATTERNS:
+        //Only reached with a single worker or from the emulation thread
+        patterns[write.addr] = write.data;
+        tiles.invalidate(write.addr);
+        break;
+    case Target::NAMETABLES:
+        target.nametables[write.addr] = write.data;
+        break;
+    case Target::PALETTE:
+        target.palette[write.addr] = write.data;
+        break;
+    case Target::OAM:
+        target.oam[write.addr] = write.data;
+        break;
+    }
+}
@@ -0,0 +1,271 @@
+#include "hash.h"
+
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRNES_X86_HASH
+#include <immintrin.h>
+#endif
+
+namespace
+{
+struct Crc32cTable
+{
+    uint32_t entries[256];
+
+    Crc32cTable()
+    {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (crc & 1 ? 0x82F63B78 : 0);
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+uint32_t crc32cSoftware(const uint8_t* data, size_t size, uint32_t crc)
+{
+    static const Crc32cTable table;
+
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+uint32_t rotl(uint32_t value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+void sha1BlocksSoftware(uint32_t state[5], const uint8_t* data, size_t nbBlocks)
+{
+    for (; nbBlocks > 0; --nbBlocks, data += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (data[i * 4] << 24) | (data[i * 4 + 1] << 16) | (data[i * 4 + 2] << 8) | data[i * 4 + 3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+
+            uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+#ifdef CRNES_X86_HASH
+__attribute__((target("sse4.2")))
+uint32_t crc32cHardware(const uint8_t* data, size_t size, uint32_t crc)
+{
+    uint64_t crc64 = crc;
+
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+
+    crc = static_cast<uint32_t>(crc64);
+    for (; size > 0; --size, ++data) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+
+//Four rounds of the 80. The message schedule runs three groups ahead of the rounds,
+//msg holds the four words groups k to k+3 are built from.
+template<int k>
+__attribute__((target("sha,sse4.1"))) inline void sha1Group(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i* msg)
+{
+    if constexpr (k == 0) {
+        e0 = _mm_add_epi32(e0, msg[0]);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+    } else if constexpr (k % 2 == 1) {
+        e1 = _mm_sha1nexte_epu32(e1, msg[k % 4]);
+        e0 = abcd;
+        if constexpr (k >= 3 && k <= 18) {
+            msg[(k + 1) % 4] = _mm_sha1msg2_epu32(msg[(k + 1) % 4], msg[k % 4]);
+        }
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, k / 5);
+    } else {
+        e0 = _mm_sha1nexte_epu32(e0, msg[k % 4]);
+        e1 = abcd;
+        if constexpr (k >= 3 && k <= 18) {
+            msg[(k + 1) % 4] = _mm_sha1msg2_epu32(msg[(k + 1) % 4], msg[k % 4]);
+        }
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, k / 5);
+    }
+
+    if constexpr (k >= 1 && k <= 16) {
+        msg[(k + 3) % 4] = _mm_sha1msg1_epu32(msg[(k + 3) % 4], msg[k % 4]);
+    }
+    if constexpr (k >= 2 && k <= 17) {
+        msg[(k + 2) % 4] = _mm_xor_si128(msg[(k + 2) % 4], msg[k % 4]);
+    }
+}
+
+template<int... k>
+__attribute__((target("sha,sse4.1"))) inline void sha1Rounds(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i* msg,
+                                                             std::integer_sequence<int, k...>)
+{
+    (sha1Group<k>(abcd, e0, e1, msg), ...);
+}
+
+__attribute__((target("sha,sse4.1")))
+void sha1BlocksHardware(uint32_t state[5], const uint8_t* data, size_t nbBlocks)
+{
+    //Big endian words, in reverse order
+    const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+    __m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+    __m128i e1;
+
+    for (; nbBlocks > 0; --nbBlocks, data += 64) {
+        __m128i abcdSave = abcd;
+        __m128i e0Save = e0;
+
+        __m128i msg[4];
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), byteSwap);
+        }
+
+        sha1Rounds(abcd, e0, e1, msg, std::make_integer_sequence<int, 20>());
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = _mm_extract_epi32(e0, 3);
+}
+#endif
+
+using Sha1Blocks = void (*)(uint32_t state[5], const uint8_t* data, size_t nbBlocks);
+
+Sha1Blocks sha1Blocks()
+{
+#ifdef CRNES_X86_HASH
+    static const Sha1Blocks blocks = hasHardwareSha1() ? sha1BlocksHardware : sha1BlocksSoftware;
+    return blocks;
+#else
+    return sha1BlocksSoftware;
+#endif
+}
+}
+
+bool hasHardwareCrc32c()
+{
+#ifdef CRNES_X86_HASH
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc)
+{
+#ifdef CRNES_X86_HASH
+    if (hasHardwareCrc32c()) {
+        return ~crc32cHardware(data, size, ~crc);
+    }
+#endif
+    return ~crc32cSoftware(data, size, ~crc);
+}
+
+bool hasHardwareSha1()
+{
+#ifdef CRNES_X86_HASH
+    //__builtin_cpu_supports has no name for the SHA extensions : CPUID leaf 7, EBX bit 29
+    static const bool supported = []() {
+        unsigned int eax, ebx, ecx, edx;
+        __asm__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0));
+        if (eax < 7) {
+            return false;
+        }
+        __asm__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+        return (ebx & (1u << 29)) != 0 && __builtin_cpu_supports("sse4.1");
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+Sha1Digest sha1(const uint8_t* data, size_t size)
+{
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    Sha1Blocks blocks = sha1Blocks();
+
+    size_t nbBlocks = size / 64;
+    blocks(state, data, nbBlocks);
+
+    //Padding : 0x80, zeros, then the length in bits as a big endian 64 bit number
+    uint8_t tail[128] = {};
+    size_t tailSize = size - nbBlocks * 64;
+    std::memcpy(tail, data + nbBlocks * 64, tailSize);
+    tail[tailSize] = 0x80;
+
+    size_t tailBlocks = tailSize + 9 <= 64 ? 1 : 2;
+    uint64_t bits = static_cast<uint64_t>(size) * 8;
+    for (int i = 0; i < 8; ++i) {
+        tail[tailBlocks * 64 - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+    blocks(state, tail, tailBlocks);
+
+    Sha1Digest digest;
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4] = state[i] >> 24;
+        digest[i * 4 + 1] = state[i] >> 16;
+        digest[i * 4 + 2] = state[i] >> 8;
+        digest[i * 4 + 3] = state[i];
+    }
+    return digest;
+}
+
+std::string toHex(const uint8_t* data, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    std::string hex(size * 2, '0');
+    for (size_t i = 0; i < size; ++i) {
+        hex[i * 2] = digits[data[i] >> 4];
+        hex[i * 2 + 1] = digits[data[i] & 0xF];
+    }
+    return hex;
+}
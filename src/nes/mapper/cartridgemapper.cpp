@@ -1,106 +1,220 @@
 #include "cartridgemapper.h"
 
+#include <chrono>
 #include <iostream>
-#include <fstream>
-#include <algorithm>
-#include <vector>
-#include <array>
 
-#include "cartridgemapper001.h"
+#include "mapperfactory.h"
+#include "ppubus.h"
+#include "romcache.h"
+#include "saveram.h"
+#include "hash.h"
+#include "trace.h"
 
-CartridgeMapper* loadCartridgeMapperFromFile(const std::string &filename)
+namespace
 {
-    std::ifstream file(filename, std::ios_base::binary);
+//game.nes, game.nes.gz and game.zip all save to game.sav
+std::string saveFilenameFor(const std::string& filename)
+{
+    std::string base = filename;
+
+    for (const char* extension : {".gz", ".zip", ".nes"}) {
+        size_t length = std::char_traits<char>::length(extension);
+        if (base.size() > length && base.compare(base.size() - length, length, extension) == 0) {
+            base.erase(base.size() - length);
+        }
+    }
+
+    return base + ".sav";
+}
+}
+
+bool loadCartridgeImage(const std::string& filename, CartridgeImage& image, bool verbose)
+{
+    TRACE_ZONE("loadCartridgeImage");
 
-    if (!file) {
+    auto start = std::chrono::steady_clock::now();
+    CartridgeLoadStats stats;
+
+    std::shared_ptr<const RomBuffer> buffer = RomBuffer::mapFile(filename);
+
+    if (!buffer) {
         std::cout << "File does not exist : " << filename << std::endl;
-        return nullptr;
+        return false;
     }
 
-    char NesStr[4] {0, 0, 0, 0};
-    uint8_t nbPrgRom = 0, nbChrRom = 0, flag6 = 0, flag7 = 0;
-    int mapperId = -1;
-    Mirroring mirroring = Mirroring::BAD_MIRRORING;
-    //bool batteryBackedSram = false;
+    stats.fileBytes = buffer->getBytes().size();
+    stats.compression = detectRomCompression(buffer->getBytes());
 
+    //The mapped archive is dropped as soon as it's inflated, only the ROM stays in memory
+    if (stats.compression != RomCompression::NONE) {
+        auto decompressStart = std::chrono::steady_clock::now();
+        buffer = decompressRom(buffer->getBytes(), stats.compression, filename);
+        stats.decompressSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - decompressStart).count();
 
-    file.read(NesStr, 4);
-    if (NesStr[0] != 'N' || NesStr[1] != 'E' || NesStr[2] != 'S' || NesStr[3] != 0x1A) {
-        std::cout << "Bad ROM file : " << filename << std::endl;
-        return nullptr;
+        if (!buffer) {
+            return false;
+        }
+    }
+
+    if (RomCache::isEnabled()) {
+        buffer = RomCache::intern(std::move(buffer));
     }
 
-    file.read(reinterpret_cast<char*>(&nbPrgRom), 1);
-    file.read(reinterpret_cast<char*>(&nbChrRom), 1);
-    file.read(reinterpret_cast<char*>(&flag6), 1);
-    file.read(reinterpret_cast<char*>(&flag7), 1);
+    stats.romBytes = buffer->getBytes().size();
 
+    if (!parseCartridgeImage(std::move(buffer), filename, image, verbose)) {
+        return false;
+    }
 
-    if ((flag7 & 0x0C) == 0x08) { //NES 2.0
-        mapperId = (flag6 >> 4) | (flag7 & 0xF0);
-    } else { //iNES
-        mapperId = (flag6 >> 4) | (flag7 & 0x70);
+    if (image.battery && SaveRam::areFilesEnabled()) {
+        image.saveFilename = saveFilenameFor(filename);
     }
 
-    //batteryBackedSram = flag6 & 0x02;
+    stats.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    image.loadStats = stats;
+
+    if (verbose && stats.compression != RomCompression::NONE) {
+        std::cout << "Decompressed " << romCompressionName(stats.compression) << " : " << stats.fileBytes << " -> "
+                  << stats.romBytes << " bytes in " << stats.decompressSeconds * 1000.0 << "ms" << std::endl;
+    }
+
+    return true;
+}
+
+bool parseINesHeader(ByteSpan bytes, INesHeader& header)
+{
+    if (bytes.size() < 16 || bytes[0] != 'N' || bytes[1] != 'E' || bytes[2] != 'S' || bytes[3] != 0x1A) {
+        return false;
+    }
+
+    uint8_t flag6 = bytes[6];
+    uint8_t flag7 = bytes[7];
+
+    header.nbPrgRom = bytes[4];
+    header.nbChrRom = bytes[5];
+    header.nes2 = (flag7 & 0x0C) == 0x08;
+
+    if (header.nes2) {
+        header.mapperId = (flag6 >> 4) | (flag7 & 0xF0);
+    } else {
+        header.mapperId = (flag6 >> 4) | (flag7 & 0x70);
+    }
 
     //TODO: Some mappers control directly the mirroring.
     if (flag6 & 0x01) {
-        mirroring = Mirroring::VERTICAL;
+        header.mirroring = Mirroring::VERTICAL;
     } else {
-        mirroring = Mirroring::HORIZONTAL;
+        header.mirroring = Mirroring::HORIZONTAL;
     }
 
     if (flag6 & 0x80) {
-        mirroring = Mirroring::FOUR_SCREEN;
+        header.mirroring = Mirroring::FOUR_SCREEN;
+    }
+
+    header.battery = flag6 & 0x02;
+    header.trainer = flag6 & 0x04;
+    header.vsUnisystem = flag7 & 0x01;
+    header.playchoice = flag7 & 0x02;
+
+    //Bytes 8 to 15 are unsupported
+
+    return true;
+}
+
+bool parseCartridgeImage(std::shared_ptr<const RomBuffer> buffer, const std::string& filename, CartridgeImage& image, bool verbose)
+{
+    ByteSpan bytes = buffer->getBytes();
+    INesHeader header;
+
+    if (!parseINesHeader(bytes, header)) {
+        std::cout << "Bad ROM file : " << filename << std::endl;
+        return false;
     }
 
-    if (flag6 & 0x04) {
+    if (header.trainer) {
         std::cout << "Trainers are not supported." << std::endl;
-        return nullptr;
+        return false;
     }
 
-    if (flag7 & 0x02) {
+    if (header.playchoice) {
         std::cout << "Playchoice 10 games not supported." << std::endl;
-        return nullptr;
+        return false;
     }
 
-    if (flag7 & 0x01) {
+    if (header.vsUnisystem) {
         std::cout << "Vs. Unisystem games not supported." << std::endl;
-        return nullptr;
+        return false;
     }
 
-    file.seekg(8, file.cur); //Unsupported bytes
-
-    std::cout << "Nb Program ROM pages : " << static_cast<unsigned int>(nbPrgRom)
-              << "\nNb Character ROM pages : " << static_cast<unsigned int>(nbChrRom)
-              << "\nMapper : " << mapperId
-              << "\nMirroring : " << static_cast<int>(mirroring) << std::endl;
+    if (verbose) {
+        std::cout << "Nb Program ROM pages : " << static_cast<unsigned int>(header.nbPrgRom)
+                  << "\nNb Character ROM pages : " << static_cast<unsigned int>(header.nbChrRom)
+                  << "\nMapper : " << header.mapperId
+                  << "\nMirroring : " << static_cast<int>(header.mirroring) << std::endl;
+    }
 
-    std::vector<std::array<uint8_t, 0x4000>> prgRoms(nbPrgRom);
-    std::vector<std::array<uint8_t, 0x2000>> chrRoms(nbChrRom);
+    size_t prgSize = header.nbPrgRom * 0x4000;
+    size_t chrSize = header.nbChrRom * 0x2000;
 
-    for (auto& prgRom : prgRoms) {
-        file.read(reinterpret_cast<char*>(prgRom.data()), 0x4000);
+    if (header.nbPrgRom == 0) {
+        std::cout << "No program ROM : " << filename << std::endl;
+        return false;
     }
 
-    for (auto& chrRom : chrRoms) {
-        file.read(reinterpret_cast<char*>(chrRom.data()), 0x2000);
+    if (bytes.size() < 16 + prgSize + chrSize) {
+        std::cout << "Truncated ROM file : " << filename << std::endl;
+        return false;
     }
 
-    //Instantiate the correct CartridgeMapper
-    switch (mapperId) {
-    case 0:
-        return new CartridgeMapper001(mirroring, prgRoms, chrRoms);
-        break;
-    default:
-        std::cout << "Mapper #" << mapperId << " is not supported." << std::endl;
+    image.mapperId = header.mapperId;
+    image.mirroring = header.mirroring;
+    image.battery = header.battery;
+    image.prgRom = bytes.subspan(16, prgSize);
+    image.chrRom = bytes.subspan(16 + prgSize, chrSize);
+    image.buffer = std::move(buffer);
+
+    return true;
+}
+
+CartridgeMapper* loadCartridgeMapperFromFile(const std::string& filename, bool verbose)
+{
+    TRACE_ZONE("loadCartridgeMapperFromFile");
+
+    CartridgeImage image;
+    if (!loadCartridgeImage(filename, image, verbose)) {
         return nullptr;
     }
+
+    return instantiateMapper<CartridgeMapper*>(image, [](auto mapper) -> CartridgeMapper* {
+        return mapper.release();
+    });
+}
+
+
+CartridgeMapper::CartridgeMapper(const CartridgeImage& image)
+    : mirroring(image.mirroring), mapperId(0), battery(image.battery), buffer(image.buffer), prgRom(image.prgRom), chrRom(image.chrRom),
+      ppuBus(nullptr)
+{
+
 }
 
-CartridgeMapper::CartridgeMapper(Mirroring mirroring, const std::vector<std::array<uint8_t, 0x4000>>& prgRom, const std::vector<std::array<uint8_t, 0x2000>>& chrRom)
-    : mirroring(mirroring), mapperId(0), prgRom(toContiguousVector(prgRom)), chrRom(toContiguousVector(chrRom))
+CartridgeMapper::~CartridgeMapper()
 {
 
 }
+
+void CartridgeMapper::mapPpuBus()
+{
+    ppuBus->setMirroring(mirroring);
+
+    for (unsigned int slot = 0; slot < PpuBus::nbChrBanks && (slot + 1) * PpuBus::pageSize <= chrRom.size(); ++slot) {
+        ppuBus->mapChrRom(slot, chrRom.data() + slot * PpuBus::pageSize);
+    }
+}
+
+void CartridgeMapper::enableCoverage()
+{
+    if (!prgCoverage) {
+        prgCoverage.reset(new PrgCoverage(prgRom.size(), fnv1a64(prgRom.data(), prgRom.size())));
+    }
+}
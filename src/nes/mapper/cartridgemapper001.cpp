@@ -1,41 +1,45 @@
 #include "cartridgemapper001.h"
+#include "bytestream.h"
+#include "ppubus.h"
 
-#include <cassert>
-
-CartridgeMapper001::CartridgeMapper001(Mirroring mirroring, const std::vector<std::array<uint8_t, 0x4000>>& prgRom, const std::vector<std::array<uint8_t, 0x2000>>& chrRom)
-    : CartridgeMapper(mirroring, prgRom, chrRom)
+CartridgeMapper001::CartridgeMapper001(const CartridgeImage& image)
+    : CartridgeMapper(image), prgRam(0x2000)
 {
-    prgRam.fill(0xFF);
+    if (!image.saveFilename.empty()) {
+        prgRam.mapFile(image.saveFilename);
+    }
+
     mapperId = 0;
 
+    if (chrRom.empty()) {
+        chrRam.assign(0x2000, 0);
+    }
+
     //If we only have one page of prg rom we have to mirror it for the higher addresses
-    prgRomMask = prgRom.size() == 1 ? 0xBFFF : 0xFFFF;
+    prgRomMask = prgRom.size() == 0x4000 ? 0xBFFF : 0xFFFF;
 }
 
-uint8_t CartridgeMapper001::readCpuBus(uint16_t addr)
+void CartridgeMapper001::mapPpuBus()
 {
-    assert(addr >= 0x6000 && addr < 0x10000);
-
-    if (addr < 0x8000) {
-        return prgRam[addr - 0x6000];
-    } else {
-        return prgRom[(addr & prgRomMask) - 0x8000];
+    if (chrRam.empty()) {
+        CartridgeMapper::mapPpuBus();
+        return;
     }
-}
 
-uint8_t CartridgeMapper001::readPpuBus(uint16_t addr)
-{
-    return 0x00;
+    ppuBus->setMirroring(mirroring);
+    for (unsigned int slot = 0; slot < PpuBus::nbChrBanks; ++slot) {
+        ppuBus->mapChrRam(slot, chrRam.data() + slot * PpuBus::pageSize);
+    }
 }
 
-void CartridgeMapper001::writeCpuBus(uint16_t addr, uint8_t data)
+void CartridgeMapper001::saveState(ByteWriter& writer) const
 {
-    assert(addr >= 0x6000 && addr < 0x8000);
-
-    prgRam[addr - 0x6000] = data;
+    prgRam.saveState(writer);
+    writer.putBytes(chrRam.data(), chrRam.size());
 }
 
-void CartridgeMapper001::writePpuBus(uint16_t addr, uint8_t data)
+void CartridgeMapper001::loadState(ByteReader& reader)
 {
-
+    prgRam.loadState(reader);
+    reader.getBytes(chrRam.data(), chrRam.size());
 }
@@ -0,0 +1,196 @@
+#include "nes.h"
+#include "bootcache.h"
+#include "bytestream.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+const char stateMagic[8] = {'C', 'R', 'N', 'E', 'S', 'S', 'T', 'A'};
+//Bump when the state layout or what the emulation does in a frame changes, cached boot
+//snapshots are then taken again
+constexpr uint32_t stateVersion = 3;
+}
+
+Nes::Nes(const std::string& cpuLogFilename, CpuAccuracy accuracy)
+    : cpuLogFilename(cpuLogFilename), accuracy(accuracy), frameCount(0), bootSnapshot(BootSnapshot::NONE), renderThreads(0), perfCounters(nullptr)
+{
+
+}
+
+bool Nes::loadCartridge(const std::string& filename, bool verbose)
+{
+    CartridgeLoadStats stats;
+    std::unique_ptr<ISystem> loaded = loadSystemFromFile(filename, accuracy, cpuLogFilename, verbose, &stats);
+
+    if (!loaded) {
+        return false;
+    }
+
+    system = std::move(loaded);
+    system->getPpu().setRenderThreads(renderThreads);
+    loadStats = stats;
+    frameCount = 0;
+    bootSnapshot = BootSnapshot::NONE;
+
+    if (BootCache::isEnabled()) {
+        boot();
+    }
+
+    return true;
+}
+
+void Nes::boot()
+{
+    TRACE_ZONE("Nes::boot");
+
+    CartridgeMapper* cartridge = system->getCartridge();
+    //A snapshot would overwrite the save file with the RAM it had when it was taken
+    bool cacheable = !cartridge->hasBattery();
+    //A snapshot loadState refuses is taken again after the warmup
+    bool rejected = false;
+
+    if (cacheable) {
+        std::shared_ptr<const RomBuffer> snapshot = BootCache::load(cartridge->getRomBytes(), accuracy);
+        if (snapshot && loadState(snapshot->getBytes())) {
+            bootSnapshot = BootSnapshot::LOADED;
+            return;
+        }
+        rejected = static_cast<bool>(snapshot);
+    }
+
+    unsigned int warmupFrames = BootCache::getWarmupFrames();
+    //Nothing shows the warmup frames, only the state they end in matters
+    for (unsigned int frame = 0; frame < warmupFrames; ++frame) {
+        runFrame(false);
+    }
+
+    if (!cacheable) {
+        bootSnapshot = BootSnapshot::BATTERY_BACKED;
+        return;
+    }
+
+    std::vector<uint8_t> state;
+    saveState(state);
+    if (!BootCache::store(cartridge->getRomBytes(), accuracy, state)) {
+        bootSnapshot = BootSnapshot::STORE_FAILED;
+    } else {
+        bootSnapshot = rejected ? BootSnapshot::REJECTED : BootSnapshot::STORED;
+    }
+}
+
+void Nes::saveState(std::vector<uint8_t>& state) const
+{
+    assert(system);
+
+    ByteWriter writer;
+    writer.putBytes(stateMagic, sizeof(stateMagic));
+    writer.put(stateVersion, 4);
+    writer.put(static_cast<uint16_t>(system->getCartridge()->getMapperId()), 2);
+    writer.put(static_cast<uint8_t>(accuracy), 1);
+    writer.put(frameCount, 8);
+    system->saveState(writer);
+
+    state = std::move(writer.data);
+}
+
+bool Nes::loadState(ByteSpan state)
+{
+    assert(system);
+
+    //The layout only depends on the mapper, a state of the wrong size can't be ours
+    std::vector<uint8_t> current;
+    saveState(current);
+
+    if (state.size() != current.size() || !std::equal(current.begin(), current.begin() + 15, state.begin())) {
+        return false;
+    }
+
+    ByteReader reader(state.subspan(15, state.size() - 15));
+    frameCount = reader.get(8);
+    system->loadState(reader);
+
+    return reader.isOk();
+}
+
+void Nes::setRenderThreads(unsigned int nbThreads)
+{
+    renderThreads = nbThreads;
+    if (system) {
+        system->getPpu().setRenderThreads(nbThreads);
+    }
+}
+
+void Nes::runCpu(uint64_t deadline)
+{
+    Cpu& cpu = system->getCpu();
+    uint64_t startInstructions = cpu.getInstructionCount();
+
+    if (perfCounters) {
+        perfCounters->begin(PerfSlice::CPU);
+    }
+
+    {
+        TRACE_ZONE("Cpu run");
+        cpu.run(deadline);
+    }
+
+    if (perfCounters) {
+        perfCounters->end(PerfSlice::CPU, cpu.getInstructionCount() - startInstructions);
+    }
+}
+
+void Nes::runFrame(bool render)
+{
+    TRACE_ZONE("Nes::runFrame");
+    assert(system);
+
+    Cpu& cpu = system->getCpu();
+    Ppu& ppu = system->getPpu();
+    //The PPU hasn't reached the first visible line of the frame yet
+    ppu.setRenderSkip(!render);
+
+    //Frame boundaries are kept in PPU dots so the fractional CPU cycle doesn't drift
+    uint64_t frameStart = frameCount * ppuDotsPerFrame;
+    uint64_t startInstructions = cpu.getInstructionCount();
+
+    if (perfCounters) {
+        perfCounters->begin(PerfSlice::FRAME);
+    }
+
+    //The CPU only stops for the vblank NMI and the end of the frame, the bus catches the PPU up
+    //whenever the program looks at it in between
+    uint64_t vblankStart = (frameStart + (Ppu::height + 1) * Ppu::dotsPerScanline) / 3;
+    uint64_t frameEnd = (frameStart + ppuDotsPerFrame) / 3;
+
+    for (uint64_t deadline : {vblankStart, frameEnd}) {
+        runCpu(deadline);
+
+        if (perfCounters) {
+            perfCounters->begin(PerfSlice::PPU);
+        }
+        ppu.catchUp(system->getBus().getCycleCount());
+        if (perfCounters) {
+            perfCounters->end(PerfSlice::PPU);
+        }
+    }
+
+    //With render threads, the lines were handed over at the end of the visible ones
+    if (perfCounters) {
+        perfCounters->begin(PerfSlice::PPU);
+    }
+    ppu.waitFrame();
+    if (perfCounters) {
+        perfCounters->end(PerfSlice::PPU);
+    }
+
+    ++frameCount;
+    system->getBus().endFrame();
+    system->getCartridge()->endFrame();
+
+    if (perfCounters) {
+        perfCounters->end(PerfSlice::FRAME, cpu.getInstructionCount() - startInstructions);
+    }
+}
@@ -0,0 +1,35 @@
+#include "opdef.h"
+
+const char* addrModeName(AddrMode addrMode)
+{
+    switch (addrMode) {
+    case AddrMode::IMPLICIT:
+        return "implicit";
+    case AddrMode::ACCUMULATOR:
+        return "accumulator";
+    case AddrMode::IMMEDIATE:
+        return "immediate";
+    case AddrMode::ZERO_PAGE:
+        return "zero page";
+    case AddrMode::ZERO_PAGE_X:
+        return "zero page,X";
+    case AddrMode::ZERO_PAGE_Y:
+        return "zero page,Y";
+    case AddrMode::RELATIVE:
+        return "relative";
+    case AddrMode::ABSOLUTE:
+        return "absolute";
+    case AddrMode::ABSOLUTE_X:
+        return "absolute,X";
+    case AddrMode::ABSOLUTE_Y:
+        return "absolute,Y";
+    case AddrMode::INDIRECT:
+        return "indirect";
+    case AddrMode::INDEXED_INDIRECT:
+        return "(indirect,X)";
+    case AddrMode::INDIRECT_INDEXED:
+        return "(indirect),Y";
+    default:
+        return "UNKNOWN";
+    }
+}
@@ -0,0 +1,201 @@
+#include "perfcounters.h"
+
+#include <iostream>
+#include <iomanip>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#endif
+
+namespace
+{
+const char* const sliceNames[] = {"frame", "cpu", "ppu", "present"};
+
+#ifdef __linux__
+int openEvent(uint32_t type, uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+uint64_t cacheConfig(uint64_t cache, uint64_t op, uint64_t result)
+{
+    return cache | (op << 8) | (result << 16);
+}
+#endif
+}
+
+PerfCounters::PerfCounters()
+    : groupFd(-1), nbOpened(0)
+{
+    fds.fill(-1);
+    groupIndex.fill(-1);
+    clear();
+
+#ifdef __linux__
+    struct EventConfig
+    {
+        uint32_t type;
+        uint64_t config;
+    };
+
+    const EventConfig configs[NB_EVENTS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, cacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+        {PERF_TYPE_HW_CACHE, cacheConfig(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)}
+    };
+
+    //Cycles lead the group, the others are optional (VMs often lack cache events)
+    groupFd = openEvent(configs[CYCLES].type, configs[CYCLES].config, -1);
+    if (groupFd < 0) {
+        std::cout << "perf_event_open failed, hardware counters are disabled : " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    fds[CYCLES] = groupFd;
+    groupIndex[CYCLES] = nbOpened++;
+
+    for (int event = CYCLES + 1; event < NB_EVENTS; ++event) {
+        fds[event] = openEvent(configs[event].type, configs[event].config, groupFd);
+        if (fds[event] >= 0) {
+            groupIndex[event] = nbOpened++;
+        }
+    }
+
+    ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+void PerfCounters::clear()
+{
+    for (auto& slice : slices) {
+        slice.start.fill(0);
+        slice.totals.fill(0);
+        slice.count = 0;
+        slice.emulatedInstructions = 0;
+    }
+}
+
+void PerfCounters::readCounters(std::array<uint64_t, NB_EVENTS>& values) const
+{
+    values.fill(0);
+
+#ifdef __linux__
+    //PERF_FORMAT_GROUP layout : nr, then one value per opened event
+    uint64_t buffer[NB_EVENTS + 1];
+    if (read(groupFd, buffer, sizeof(uint64_t) * (nbOpened + 1)) <= 0) {
+        return;
+    }
+
+    for (int event = 0; event < NB_EVENTS; ++event) {
+        if (groupIndex[event] >= 0) {
+            values[event] = buffer[1 + groupIndex[event]];
+        }
+    }
+#endif
+}
+
+void PerfCounters::begin(PerfSlice slice)
+{
+    if (!isAvailable()) {
+        return;
+    }
+
+    readCounters(slices[static_cast<int>(slice)].start);
+}
+
+void PerfCounters::end(PerfSlice slice, uint64_t emulatedInstructions)
+{
+    if (!isAvailable()) {
+        return;
+    }
+
+    std::array<uint64_t, NB_EVENTS> values;
+    readCounters(values);
+
+    SliceTotals& totals = slices[static_cast<int>(slice)];
+    for (int event = 0; event < NB_EVENTS; ++event) {
+        totals.totals[event] += values[event] - totals.start[event];
+    }
+    ++totals.count;
+    totals.emulatedInstructions += emulatedInstructions;
+}
+
+void PerfCounters::writeReport(std::ostream& os) const
+{
+    if (!isAvailable()) {
+        os << "Hardware counters unavailable" << std::endl;
+        return;
+    }
+
+    auto perUnit = [](uint64_t value, uint64_t unit) {
+        return unit > 0 ? static_cast<double>(value) / unit : 0.0;
+    };
+
+    os << std::left << std::setw(9) << "Slice" << std::right
+       << std::setw(8) << "Count" << std::setw(16) << "Cycles/slice" << std::setw(8) << "IPC"
+       << std::setw(14) << "BrMiss/slice" << std::setw(14) << "L1DMiss/slice" << std::setw(14) << "LLCMiss/slice"
+       << std::setw(12) << "Cyc/EmuIns" << std::setw(12) << "Ins/EmuIns" << std::setw(15) << "BrMiss/EmuIns"
+       << std::setw(16) << "L1DMiss/EmuIns" << std::setw(16) << "LLCMiss/EmuIns"
+       << "\n";
+
+    os << std::fixed << std::setprecision(2);
+    for (int slice = 0; slice < nbSlices; ++slice) {
+        const SliceTotals& totals = slices[slice];
+        if (totals.count == 0) {
+            continue;
+        }
+
+        os << std::left << std::setw(9) << sliceNames[slice] << std::right
+           << std::setw(8) << totals.count
+           << std::setw(16) << perUnit(totals.totals[CYCLES], totals.count)
+           << std::setw(8) << perUnit(totals.totals[INSTRUCTIONS], totals.totals[CYCLES])
+           << std::setw(14) << perUnit(totals.totals[BRANCH_MISSES], totals.count)
+           << std::setw(14) << perUnit(totals.totals[L1D_MISSES], totals.count)
+           << std::setw(14) << perUnit(totals.totals[LLC_MISSES], totals.count);
+
+        if (totals.emulatedInstructions > 0) {
+            os << std::setw(12) << perUnit(totals.totals[CYCLES], totals.emulatedInstructions)
+               << std::setw(12) << perUnit(totals.totals[INSTRUCTIONS], totals.emulatedInstructions)
+               << std::setw(15) << perUnit(totals.totals[BRANCH_MISSES], totals.emulatedInstructions)
+               << std::setw(16) << perUnit(totals.totals[L1D_MISSES], totals.emulatedInstructions)
+               << std::setw(16) << perUnit(totals.totals[LLC_MISSES], totals.emulatedInstructions);
+        }
+        os << "\n";
+    }
+
+    for (int event = 0; event < NB_EVENTS; ++event) {
+        if (groupIndex[event] < 0) {
+            static const char* const eventNames[] = {"cycles", "instructions", "branch-misses", "L1D read misses", "LLC read misses"};
+            os << "(" << eventNames[event] << " not supported on this host)\n";
+        }
+    }
+}
@@ -0,0 +1,263 @@
+#include "pixelcompose.h"
+#include "ppu.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRNES_X86_COMPOSE
+#include <immintrin.h>
+#endif
+
+namespace
+{
+constexpr uint8_t spriteBehind = 0x20;
+constexpr uint8_t spriteZero = 0x40;
+
+static_assert(Ppu::width % 32 == 0, "The vector kernels have no tail loop");
+
+bool composeScalar(const uint8_t* background, const uint8_t* sprites, const uint32_t* colors, uint32_t* out)
+{
+    bool sprite0Hit = false;
+
+    for (int x = 0; x < Ppu::width; ++x) {
+        uint8_t bg = background[x];
+        uint8_t sprite = sprites[x];
+        bool bgOpaque = bg & 0x03;
+        bool spriteOpaque = sprite & 0x03;
+
+        //The hardware never reports a hit on the last column
+        if ((sprite & spriteZero) && spriteOpaque && bgOpaque && x != Ppu::width - 1) {
+            sprite0Hit = true;
+        }
+
+        uint8_t index = bgOpaque ? bg : 0;
+        if (spriteOpaque && (!(sprite & spriteBehind) || !bgOpaque)) {
+            index = sprite & 0x1F;
+        }
+
+        out[x] = colors[index];
+    }
+
+    return sprite0Hit;
+}
+
+#ifdef CRNES_X86_COMPOSE
+//Each channel of the 32 colors as two 16 byte tables, the first and second half of palette RAM
+void splitChannels(const uint32_t* colors, uint8_t tables[4][2][16])
+{
+    for (int i = 0; i < 32; ++i) {
+        for (int channel = 0; channel < 4; ++channel) {
+            tables[channel][i >> 4][i & 0x0F] = static_cast<uint8_t>(colors[i] >> (channel * 8));
+        }
+    }
+}
+
+//pshufb only looks up 16 entries and zeroes lanes whose index has bit 7 set. Adding $70 keeps
+//indices 0-15 for the low table and pushes 16-31 past $80, adding $F0 does the opposite.
+__attribute__((target("ssse3")))
+bool composeSsse3(const uint8_t* background, const uint8_t* sprites, const uint32_t* colors, uint32_t* out)
+{
+    alignas(16) uint8_t bytes[4][2][16];
+    splitChannels(colors, bytes);
+
+    __m128i tables[4][2];
+    for (int channel = 0; channel < 4; ++channel) {
+        tables[channel][0] = _mm_load_si128(reinterpret_cast<const __m128i*>(bytes[channel][0]));
+        tables[channel][1] = _mm_load_si128(reinterpret_cast<const __m128i*>(bytes[channel][1]));
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i colorBits = _mm_set1_epi8(0x03);
+    const __m128i behindBit = _mm_set1_epi8(spriteBehind);
+    const __m128i zeroBit = _mm_set1_epi8(spriteZero);
+    const __m128i indexBits = _mm_set1_epi8(0x1F);
+    const __m128i lowBias = _mm_set1_epi8(0x70);
+    const __m128i highBias = _mm_set1_epi8(static_cast<char>(0xF0));
+
+    uint32_t hits = 0;
+
+    for (int x = 0; x < Ppu::width; x += 16) {
+        __m128i bg = _mm_loadu_si128(reinterpret_cast<const __m128i*>(background + x));
+        __m128i sprite = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sprites + x));
+
+        __m128i bgTransparent = _mm_cmpeq_epi8(_mm_and_si128(bg, colorBits), zero);
+        __m128i spriteTransparent = _mm_cmpeq_epi8(_mm_and_si128(sprite, colorBits), zero);
+        __m128i behind = _mm_cmpeq_epi8(_mm_and_si128(sprite, behindBit), behindBit);
+        __m128i isSprite0 = _mm_cmpeq_epi8(_mm_and_si128(sprite, zeroBit), zeroBit);
+
+        //The background shows where there is no sprite, or the sprite is behind an opaque background
+        __m128i showBg = _mm_or_si128(spriteTransparent, _mm_andnot_si128(bgTransparent, behind));
+        __m128i index = _mm_or_si128(_mm_and_si128(showBg, _mm_andnot_si128(bgTransparent, bg)),
+                                     _mm_andnot_si128(showBg, _mm_and_si128(sprite, indexBits)));
+
+        uint32_t hitBits = _mm_movemask_epi8(_mm_andnot_si128(_mm_or_si128(spriteTransparent, bgTransparent), isSprite0));
+        if (x == Ppu::width - 16) {
+            hitBits &= 0x7FFF;
+        }
+        hits |= hitBits;
+
+        __m128i lowIndex = _mm_add_epi8(index, lowBias);
+        __m128i highIndex = _mm_add_epi8(index, highBias);
+        __m128i planes[4];
+        for (int channel = 0; channel < 4; ++channel) {
+            planes[channel] = _mm_or_si128(_mm_shuffle_epi8(tables[channel][0], lowIndex),
+                                           _mm_shuffle_epi8(tables[channel][1], highIndex));
+        }
+
+        //R, G, B and A planes back to RGBA pixels
+        __m128i rg0 = _mm_unpacklo_epi8(planes[0], planes[1]);
+        __m128i rg1 = _mm_unpackhi_epi8(planes[0], planes[1]);
+        __m128i ba0 = _mm_unpacklo_epi8(planes[2], planes[3]);
+        __m128i ba1 = _mm_unpackhi_epi8(planes[2], planes[3]);
+
+        __m128i* dest = reinterpret_cast<__m128i*>(out + x);
+        _mm_storeu_si128(dest, _mm_unpacklo_epi16(rg0, ba0));
+        _mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(rg0, ba0));
+        _mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(rg1, ba1));
+        _mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(rg1, ba1));
+    }
+
+    return hits != 0;
+}
+
+//Same as the SSSE3 kernel, shuffles and unpacks work within each 128 bit lane so the tables are
+//in both lanes and the pixels come out as 0-7 | 16-23, ... until the final permutes.
+__attribute__((target("avx2")))
+bool composeAvx2(const uint8_t* background, const uint8_t* sprites, const uint32_t* colors, uint32_t* out)
+{
+    alignas(16) uint8_t bytes[4][2][16];
+    splitChannels(colors, bytes);
+
+    __m256i tables[4][2];
+    for (int channel = 0; channel < 4; ++channel) {
+        tables[channel][0] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(bytes[channel][0])));
+        tables[channel][1] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(bytes[channel][1])));
+    }
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i colorBits = _mm256_set1_epi8(0x03);
+    const __m256i behindBit = _mm256_set1_epi8(spriteBehind);
+    const __m256i zeroBit = _mm256_set1_epi8(spriteZero);
+    const __m256i indexBits = _mm256_set1_epi8(0x1F);
+    const __m256i lowBias = _mm256_set1_epi8(0x70);
+    const __m256i highBias = _mm256_set1_epi8(static_cast<char>(0xF0));
+
+    uint32_t hits = 0;
+
+    for (int x = 0; x < Ppu::width; x += 32) {
+        __m256i bg = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(background + x));
+        __m256i sprite = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sprites + x));
+
+        __m256i bgTransparent = _mm256_cmpeq_epi8(_mm256_and_si256(bg, colorBits), zero);
+        __m256i spriteTransparent = _mm256_cmpeq_epi8(_mm256_and_si256(sprite, colorBits), zero);
+        __m256i behind = _mm256_cmpeq_epi8(_mm256_and_si256(sprite, behindBit), behindBit);
+        __m256i isSprite0 = _mm256_cmpeq_epi8(_mm256_and_si256(sprite, zeroBit), zeroBit);
+
+        __m256i showBg = _mm256_or_si256(spriteTransparent, _mm256_andnot_si256(bgTransparent, behind));
+        __m256i index = _mm256_or_si256(_mm256_and_si256(showBg, _mm256_andnot_si256(bgTransparent, bg)),
+                                        _mm256_andnot_si256(showBg, _mm256_and_si256(sprite, indexBits)));
+
+        uint32_t hitBits = _mm256_movemask_epi8(_mm256_andnot_si256(_mm256_or_si256(spriteTransparent, bgTransparent), isSprite0));
+        if (x == Ppu::width - 32) {
+            hitBits &= 0x7FFFFFFF;
+        }
+        hits |= hitBits;
+
+        __m256i lowIndex = _mm256_add_epi8(index, lowBias);
+        __m256i highIndex = _mm256_add_epi8(index, highBias);
+        __m256i planes[4];
+        for (int channel = 0; channel < 4; ++channel) {
+            planes[channel] = _mm256_or_si256(_mm256_shuffle_epi8(tables[channel][0], lowIndex),
+                                              _mm256_shuffle_epi8(tables[channel][1], highIndex));
+        }
+
+        __m256i rg0 = _mm256_unpacklo_epi8(planes[0], planes[1]);
+        __m256i rg1 = _mm256_unpackhi_epi8(planes[0], planes[1]);
+        __m256i ba0 = _mm256_unpacklo_epi8(planes[2], planes[3]);
+        __m256i ba1 = _mm256_unpackhi_epi8(planes[2], planes[3]);
+
+        __m256i pixels0 = _mm256_unpacklo_epi16(rg0, ba0); //0-3 | 16-19
+        __m256i pixels1 = _mm256_unpackhi_epi16(rg0, ba0); //4-7 | 20-23
+        __m256i pixels2 = _mm256_unpacklo_epi16(rg1, ba1); //8-11 | 24-27
+        __m256i pixels3 = _mm256_unpackhi_epi16(rg1, ba1); //12-15 | 28-31
+
+        __m256i* dest = reinterpret_cast<__m256i*>(out + x);
+        _mm256_storeu_si256(dest, _mm256_permute2x128_si256(pixels0, pixels1, 0x20));
+        _mm256_storeu_si256(dest + 1, _mm256_permute2x128_si256(pixels2, pixels3, 0x20));
+        _mm256_storeu_si256(dest + 2, _mm256_permute2x128_si256(pixels0, pixels1, 0x31));
+        _mm256_storeu_si256(dest + 3, _mm256_permute2x128_si256(pixels2, pixels3, 0x31));
+    }
+
+    return hits != 0;
+}
+#endif
+
+using ComposeFunction = bool (*)(const uint8_t* background, const uint8_t* sprites, const uint32_t* colors, uint32_t* out);
+
+ComposeFunction composeFunction(ComposeKernel kernel)
+{
+    if (!isComposeKernelSupported(kernel)) {
+        return composeScalar;
+    }
+
+    switch (kernel) {
+#ifdef CRNES_X86_COMPOSE
+    case ComposeKernel::SSSE3:
+        return composeSsse3;
+    case ComposeKernel::AVX2:
+        return composeAvx2;
+#endif
+    default:
+        return composeScalar;
+    }
+}
+}
+
+bool composeScanline(const uint8_t* background, const uint8_t* sprites, const uint32_t* colors, uint32_t* out)
+{
+    static const ComposeFunction compose = composeFunction(bestComposeKernel());
+    return compose(background, sprites, colors, out);
+}
+
+bool composeScanline(ComposeKernel kernel, const uint8_t* background, const uint8_t* sprites, const uint32_t* colors, uint32_t* out)
+{
+    return composeFunction(kernel)(background, sprites, colors, out);
+}
+
+bool isComposeKernelSupported(ComposeKernel kernel)
+{
+    switch (kernel) {
+    case ComposeKernel::SCALAR:
+        return true;
+#ifdef CRNES_X86_COMPOSE
+    case ComposeKernel::SSSE3: {
+        static const bool supported = __builtin_cpu_supports("ssse3");
+        return supported;
+    }
+    case ComposeKernel::AVX2: {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+ComposeKernel bestComposeKernel()
+{
+    if (isComposeKernelSupported(ComposeKernel::AVX2)) {
+        return ComposeKernel::AVX2;
+    }
+    return isComposeKernelSupported(ComposeKernel::SSSE3) ? ComposeKernel::SSSE3 : ComposeKernel::SCALAR;
+}
+
+const char* composeKernelName(ComposeKernel kernel)
+{
+    switch (kernel) {
+    case ComposeKernel::SSSE3:
+        return "ssse3";
+    case ComposeKernel::AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
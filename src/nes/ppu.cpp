@@ -0,0 +1,304 @@
+#include "ppu.h"
+#include "bytestream.h"
+#include "cpu.h"
+#include "trace.h"
+
+#include <algorithm>
+
+Ppu::Ppu()
+    : cpu(nullptr), tileCache(&bus), bus(memory.nametables.data(), &tileCache), ctrl(0), mask(0), status(0), oamAddr(0),
+      v(0), t(0), fineX(0), writeToggle(false), readBuffer(0), openBus(0), scanline(0),
+      lineStartDot(0), lineRendered(false), renderSkip(false)
+{
+    scheduleNextEvent();
+    memory.nametables.fill(0);
+    memory.palette.fill(0);
+    //Y = $FF keeps uninitialized sprites below the screen
+    memory.oam.fill(0xFF);
+    frame.fill(paletteColor(0x0F));
+}
+
+uint8_t Ppu::readRegister(uint16_t addr)
+{
+    switch (addr & 0x0007) {
+    case 2: { //PPUSTATUS
+        uint8_t result = (status & 0xE0) | (openBus & 0x1F);
+        status &= 0x7F;
+        writeToggle = false;
+        openBus = result;
+        return result;
+    }
+    case 4: //OAMDATA
+        openBus = memory.oam[oamAddr];
+        return openBus;
+    case 7: { //PPUDATA, buffered except for the palette
+        uint8_t result;
+
+        if ((v & 0x3FFF) < 0x3F00) {
+            result = readBuffer;
+            readBuffer = readMemory(v);
+        } else {
+            result = (memory.palette[paletteIndex(v)] & 0x3F) | (openBus & 0xC0);
+            readBuffer = readMemory(v - 0x1000);
+        }
+
+        v = (v + ((ctrl & 0x04) ? 32 : 1)) & 0x7FFF;
+        openBus = result;
+        return result;
+    }
+    default:
+        return openBus;
+    }
+}
+
+void Ppu::writeRegister(uint16_t addr, uint8_t data)
+{
+    openBus = data;
+
+    switch (addr & 0x0007) {
+    case 0: { //PPUCTRL
+        bool nmiWasEnabled = ctrl & 0x80;
+        ctrl = data;
+        t = (t & 0xF3FF) | ((data & 0x03) << 10);
+
+        //Enabling NMI during vblank fires one right away
+        if (!nmiWasEnabled && (ctrl & 0x80) && (status & 0x80) && cpu) {
+            cpu->nmi();
+        }
+        break;
+    }
+    case 1: //PPUMASK
+        mask = data;
+        break;
+    case 3: //OAMADDR
+        oamAddr = data;
+        break;
+    case 4: //OAMDATA
+        writeOam(data);
+        break;
+    case 5: //PPUSCROLL
+        if (!writeToggle) {
+            t = (t & 0xFFE0) | (data >> 3);
+            fineX = data & 0x07;
+        } else {
+            t = (t & 0x8C1F) | ((data & 0xF8) << 2) | ((data & 0x07) << 12);
+        }
+        writeToggle = !writeToggle;
+        break;
+    case 6: //PPUADDR
+        if (!writeToggle) {
+            t = (t & 0x00FF) | ((data & 0x3F) << 8);
+        } else {
+            t = (t & 0xFF00) | data;
+            v = t;
+        }
+        writeToggle = !writeToggle;
+        break;
+    case 7: //PPUDATA
+        writeMemory(v, data);
+        v = (v + ((ctrl & 0x04) ? 32 : 1)) & 0x7FFF;
+        break;
+    default: //PPUSTATUS is read-only
+        break;
+    }
+}
+
+uint8_t Ppu::readMemory(uint16_t addr)
+{
+    addr &= 0x3FFF;
+
+    if (addr < 0x3F00) {
+        return bus.read(addr);
+    }
+    return memory.palette[paletteIndex(addr)];
+}
+
+void Ppu::writeMemory(uint16_t addr, uint8_t data)
+{
+    addr &= 0x3FFF;
+
+    if (addr < 0x2000) {
+        bus.write(addr, data);
+        //CHR-ROM ignores the write, log what the pattern space holds now
+        if (frameRenderer) {
+            frameRenderer->logWrite(FrameRenderer::Target::PATTERNS, addr, bus.read(addr));
+        }
+    } else if (addr < 0x3F00) {
+        bus.write(addr, data);
+        if (frameRenderer) {
+            frameRenderer->logWrite(FrameRenderer::Target::NAMETABLES, bus.nametableOffset(addr), data);
+        }
+    } else {
+        unsigned int index = paletteIndex(addr);
+        memory.palette[index] = data & 0x3F;
+        if (frameRenderer) {
+            frameRenderer->logWrite(FrameRenderer::Target::PALETTE, index, data & 0x3F);
+        }
+    }
+}
+
+void Ppu::runEvents(uint64_t cycle)
+{
+    //Only reached when there's a line event to run, catchUp's early out stays free
+    TRACE_ZONE("Ppu catch-up");
+
+    while (cycle >= nextEventCycle) {
+        if (!lineRendered) {
+            renderScanline();
+            lineRendered = true;
+        } else {
+            endScanline();
+            lineStartDot += dotsPerScanline;
+            lineRendered = false;
+        }
+        scheduleNextEvent();
+    }
+}
+
+void Ppu::renderScanline()
+{
+    if (scanline >= height && scanline != nbScanlines - 1) {
+        return;
+    }
+
+    if (scanline < height) {
+        PpuLineRegisters registers = {v, fineX, ctrl, mask, bus.getNametableLayout()};
+
+        //The render threads draw the line later, skipped frames aren't drawn at all
+        if (frameRenderer || renderSkip) {
+            status |= scanlineStatus(memory, tileCache, registers, scanline, status & sprite0HitFlag);
+        } else {
+            status |= drawScanline(memory, tileCache, registers, scanline, frame.data() + scanline * width);
+        }
+
+        //Skipped lines are still handed over so the threads replay the writes made during them
+        if (frameRenderer) {
+            logRemappedChrBanks();
+            if (!renderSkip) {
+                frameRenderer->logLine(scanline, registers);
+            }
+            if (scanline == height - 1) {
+                frameRenderer->renderFrame(frame.data());
+            }
+        }
+    }
+
+    //What the hardware does at dots 256 and 257, and on the pre-render line from 280 to 304
+    if (isRenderingEnabled()) {
+        incrementY();
+        copyX();
+        oamAddr = 0;
+
+        if (scanline == nbScanlines - 1) {
+            copyY();
+        }
+    }
+}
+
+void Ppu::endScanline()
+{
+    ++scanline;
+
+    if (scanline == height + 1) {
+        status |= 0x80;
+        if ((ctrl & 0x80) && cpu) {
+            cpu->nmi();
+        }
+    } else if (scanline == nbScanlines - 1) {
+        status &= 0x1F;
+    } else if (scanline == nbScanlines) {
+        scanline = 0;
+    }
+}
+
+void Ppu::incrementY()
+{
+    if ((v & 0x7000) != 0x7000) {
+        v += 0x1000;
+        return;
+    }
+
+    v &= ~0x7000;
+    unsigned int coarseY = (v & 0x03E0) >> 5;
+
+    //Row 29 is the last one of a nametable, 30 and 31 are the attributes and wrap without switching
+    if (coarseY == 29) {
+        coarseY = 0;
+        v ^= 0x0800;
+    } else if (coarseY == 31) {
+        coarseY = 0;
+    } else {
+        ++coarseY;
+    }
+
+    v = (v & ~0x03E0) | (coarseY << 5);
+}
+
+void Ppu::saveState(ByteWriter& writer) const
+{
+    writer.put(ctrl, 1);
+    writer.put(mask, 1);
+    writer.put(status, 1);
+    writer.put(oamAddr, 1);
+    writer.put(v, 2);
+    writer.put(t, 2);
+    writer.put(fineX, 1);
+    writer.put(writeToggle, 1);
+    writer.put(readBuffer, 1);
+    writer.put(openBus, 1);
+    writer.put(scanline, 2);
+    writer.put(lineStartDot, 8);
+    writer.put(lineRendered, 1);
+    writer.putBytes(memory.nametables.data(), memory.nametables.size());
+    writer.putBytes(memory.palette.data(), memory.palette.size());
+    writer.putBytes(memory.oam.data(), memory.oam.size());
+}
+
+void Ppu::loadState(ByteReader& reader)
+{
+    ctrl = reader.get(1);
+    mask = reader.get(1);
+    status = reader.get(1);
+    oamAddr = reader.get(1);
+    v = reader.get(2);
+    t = reader.get(2);
+    fineX = reader.get(1);
+    writeToggle = reader.get(1);
+    readBuffer = reader.get(1);
+    openBus = reader.get(1);
+    scanline = reader.get(2);
+    lineStartDot = reader.get(8);
+    lineRendered = reader.get(1);
+    scheduleNextEvent();
+    reader.getBytes(memory.nametables.data(), memory.nametables.size());
+    reader.getBytes(memory.palette.data(), memory.palette.size());
+    reader.getBytes(memory.oam.data(), memory.oam.size());
+
+    //CHR-RAM may hold something else now
+    tileCache.invalidateAll();
+}
+
+void Ppu::setRenderThreads(unsigned int nbThreads)
+{
+    //The renderer starts from the memories as they are now
+    frameRenderer.reset();
+    bus.takeRemappedChrBanks();
+    if (nbThreads > 0) {
+        frameRenderer = std::make_unique<FrameRenderer>(bus, memory, nbThreads);
+    }
+}
+
+void Ppu::logRemappedChrBanks()
+{
+    //The workers have their own copy of the pattern space, a switched bank is logged as writes
+    uint8_t banks = bus.takeRemappedChrBanks();
+
+    for (unsigned int slot = 0; banks; ++slot, banks >>= 1) {
+        if (!(banks & 1)) {
+            continue;
+        }
+        for (uint16_t addr = slot * PpuBus::pageSize; addr < (slot + 1) * PpuBus::pageSize; ++addr) {
+            frameRenderer->logWrite(FrameRenderer::Target::PATTERNS, addr, bus.read(addr));
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#include "ppubus.h"
+#include "chrtilecache.h"
+
+namespace
+{
+//What the pattern space reads before the mapper maps anything
+const std::array<uint8_t, PpuBus::pageSize> openChr = {};
+}
+
+PpuBus::PpuBus(uint8_t* nametables, ChrTileCache* tiles)
+    : nametables(nametables), tiles(tiles), remappedChrBanks(0)
+{
+    setNametableLayout(0);
+    chrBanks.fill(openChr.data());
+    chrRamBanks.fill(nullptr);
+}
+
+void PpuBus::mapChrRom(unsigned int slot, const uint8_t* bank)
+{
+    mapChr(slot, bank, nullptr);
+}
+
+void PpuBus::mapChrRam(unsigned int slot, uint8_t* bank)
+{
+    mapChr(slot, bank, bank);
+}
+
+void PpuBus::setNametableLayout(uint8_t layout)
+{
+    this->layout = layout;
+
+    for (unsigned int i = 0; i < 4; ++i) {
+        nametablePages[i] = nametables + ((layout >> (i * 2)) & 0x03) * pageSize;
+    }
+}
+
+uint8_t PpuBus::nametableLayout(Mirroring mirroring)
+{
+    switch (mirroring) {
+    case Mirroring::VERTICAL:
+        return 0x44; //0 1 0 1
+    case Mirroring::HORIZONTAL:
+        return 0x50; //0 0 1 1
+    case Mirroring::FOUR_SCREEN:
+        return 0xE4; //0 1 2 3
+    default:
+        return 0x00;
+    }
+}
+
+void PpuBus::mapChr(unsigned int slot, const uint8_t* bank, uint8_t* ram)
+{
+    if (chrBanks[slot] == bank && chrRamBanks[slot] == ram) {
+        return;
+    }
+
+    chrBanks[slot] = bank;
+    chrRamBanks[slot] = ram;
+    remappedChrBanks |= 1 << slot;
+    tiles->invalidate(slot * pageSize, pageSize);
+}
+
+void PpuBus::writeChr(uint16_t addr, uint8_t data)
+{
+    uint8_t* bank = chrRamBanks[addr >> 10];
+    if (!bank) {
+        return;
+    }
+
+    uint16_t offset = addr & (pageSize - 1);
+    bank[offset] = data;
+
+    //A bank can be mapped in several slots
+    for (unsigned int slot = 0; slot < nbChrBanks; ++slot) {
+        if (chrRamBanks[slot] == bank) {
+            tiles->invalidate(slot * pageSize + offset);
+        }
+    }
+}
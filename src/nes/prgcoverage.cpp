@@ -0,0 +1,172 @@
+#include "prgcoverage.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+//File layout (little endian) :
+//  8 bytes  "CRNESCOV"
+//  4 bytes  version
+//  8 bytes  PRG-ROM hash
+//  8 bytes  PRG-ROM size
+//  N bytes  flags
+constexpr char magic[8] = {'C', 'R', 'N', 'E', 'S', 'C', 'O', 'V'};
+constexpr uint32_t version = 1;
+
+template<typename T>
+void writeLE(std::ostream& os, T value)
+{
+    for (unsigned int i = 0; i < sizeof(T); ++i) {
+        os.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+template<typename T>
+T readLE(std::istream& is)
+{
+    T value = 0;
+    for (unsigned int i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(static_cast<uint8_t>(is.get())) << (8 * i);
+    }
+    return value;
+}
+}
+
+PrgCoverage::PrgCoverage(size_t prgSize, uint64_t prgHash)
+    : prgHash(prgHash), flags(prgSize, 0)
+{
+
+}
+
+void PrgCoverage::clear()
+{
+    std::fill(flags.begin(), flags.end(), 0);
+}
+
+bool PrgCoverage::merge(const PrgCoverage& other)
+{
+    if (other.prgHash != prgHash || other.flags.size() != flags.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < flags.size(); ++i) {
+        flags[i] |= other.flags[i];
+    }
+
+    return true;
+}
+
+bool PrgCoverage::save(const std::string& filename) const
+{
+    std::ofstream file(filename, std::ios_base::binary);
+
+    if (!file) {
+        std::cout << "Cannot write coverage file : " << filename << std::endl;
+        return false;
+    }
+
+    file.write(magic, sizeof(magic));
+    writeLE<uint32_t>(file, version);
+    writeLE<uint64_t>(file, prgHash);
+    writeLE<uint64_t>(file, flags.size());
+    file.write(reinterpret_cast<const char*>(flags.data()), flags.size());
+
+    return static_cast<bool>(file);
+}
+
+bool PrgCoverage::load(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios_base::binary);
+
+    if (!file) {
+        std::cout << "File does not exist : " << filename << std::endl;
+        return false;
+    }
+
+    char fileMagic[sizeof(magic)];
+    file.read(fileMagic, sizeof(fileMagic));
+    if (!file || std::memcmp(fileMagic, magic, sizeof(magic)) != 0 || readLE<uint32_t>(file) != version) {
+        std::cout << "Bad coverage file : " << filename << std::endl;
+        return false;
+    }
+
+    uint64_t fileHash = readLE<uint64_t>(file);
+    uint64_t fileSize = readLE<uint64_t>(file);
+
+    //The flags are the rest of the file, the size isn't trusted before that's checked
+    std::streamoff flagsStart = file.tellg();
+    file.seekg(0, std::ios_base::end);
+    std::streamoff flagsEnd = file.tellg();
+    file.seekg(flagsStart);
+    if (!file || flagsStart < 0 || static_cast<uint64_t>(flagsEnd - flagsStart) != fileSize) {
+        std::cout << "Truncated coverage file : " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> fileFlags(fileSize);
+    file.read(reinterpret_cast<char*>(fileFlags.data()), fileSize);
+    if (!file) {
+        std::cout << "Truncated coverage file : " << filename << std::endl;
+        return false;
+    }
+
+    prgHash = fileHash;
+    flags.swap(fileFlags);
+
+    return true;
+}
+
+std::unique_ptr<PrgCoverage> PrgCoverage::loadFile(const std::string& filename)
+{
+    std::unique_ptr<PrgCoverage> coverage(new PrgCoverage(0, 0));
+
+    if (!coverage->load(filename)) {
+        return nullptr;
+    }
+
+    return coverage;
+}
+
+bool PrgCoverage::mergeFile(const std::string& filename)
+{
+    std::unique_ptr<PrgCoverage> other = loadFile(filename);
+
+    if (!other) {
+        return false;
+    }
+
+    if (!merge(*other)) {
+        std::cout << "Coverage file is for another ROM : " << filename << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void PrgCoverage::writeSummary(std::ostream& os) const
+{
+    os << "Bank    Opcode   Operand      Data   Dummy  Untouched\n";
+
+    for (size_t bankStart = 0; bankStart < flags.size(); bankStart += bankSize) {
+        size_t bankEnd = std::min(flags.size(), bankStart + bankSize);
+        unsigned int opcodes = 0, operands = 0, data = 0, dummies = 0, untouched = 0;
+
+        for (size_t i = bankStart; i < bankEnd; ++i) {
+            uint8_t f = flags[i];
+            opcodes += (f & static_cast<uint8_t>(BusAccess::OPCODE)) ? 1 : 0;
+            operands += (f & static_cast<uint8_t>(BusAccess::OPERAND)) ? 1 : 0;
+            data += (f & static_cast<uint8_t>(BusAccess::DATA)) ? 1 : 0;
+            dummies += (f & static_cast<uint8_t>(BusAccess::DUMMY)) ? 1 : 0;
+            untouched += f == 0 ? 1 : 0;
+        }
+
+        os << std::setw(4) << bankStart / bankSize
+           << std::setw(10) << opcodes << std::setw(10) << operands
+           << std::setw(10) << data << std::setw(8) << dummies
+           << std::setw(11) << untouched << "\n";
+    }
+}
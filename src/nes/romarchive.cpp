@@ -0,0 +1,266 @@
+#include "romarchive.h"
+#include "cartridgemapper.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef CRNES_ZLIB
+#include <zlib.h>
+#endif
+
+namespace
+{
+bool endsWith(const std::string& name, const char* suffix)
+{
+    size_t length = std::strlen(suffix);
+    if (name.size() < length) {
+        return false;
+    }
+
+    std::string end = name.substr(name.size() - length);
+    std::transform(end.begin(), end.end(), end.begin(), [](unsigned char c) { return std::tolower(c); });
+    return end == suffix;
+}
+
+uint32_t readLittleEndian(const uint8_t* bytes, int nbBytes)
+{
+    uint32_t value = 0;
+    for (int i = nbBytes - 1; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+#ifdef CRNES_ZLIB
+//Largest image an iNES header can describe. Sizes from containers are capped to it so a few
+//crafted bytes can't ask for gigabytes.
+constexpr size_t maxRomSize = 16 + 512 + 255 * 0x4000 + 255 * 0x2000;
+
+//Size the header announces, so the rest of the stream goes to its final place without
+//reallocating. 0 if the first bytes aren't an iNES header.
+size_t expectedRomSize(const std::vector<uint8_t>& out)
+{
+    INesHeader header;
+    if (!parseINesHeader(ByteSpan(out.data(), out.size()), header)) {
+        return 0;
+    }
+    return 16 + (header.trainer ? 512 : 0) + header.nbPrgRom * 0x4000 + header.nbChrRom * 0x2000;
+}
+
+//windowBits selects the format, see inflateInit2. sizeHint is the output size the container
+//announces, 0 if it doesn't. It's only used to size the buffer, the output never grows past
+//maxRomSize.
+bool inflateAll(ByteSpan compressed, int windowBits, size_t sizeHint, std::vector<uint8_t>& out)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+
+    if (inflateInit2(&stream, windowBits) != Z_OK) {
+        return false;
+    }
+
+    //zlib takes 32 bit lengths
+    size_t inputLeft = compressed.size();
+    const uint8_t* input = compressed.data();
+
+    out.resize(sizeHint > 0 ? std::min(sizeHint, maxRomSize) : 16);
+    size_t outSize = 0;
+    bool headerSized = sizeHint > 0;
+    int result = Z_OK;
+
+    while (result != Z_STREAM_END) {
+        if (outSize == out.size()) {
+            if (outSize >= maxRomSize) {
+                result = Z_DATA_ERROR; //Bigger than any iNES image
+                break;
+            }
+            if (!headerSized && outSize >= 16) {
+                headerSized = true;
+                out.resize(std::min(std::max(expectedRomSize(out), out.size() * 2), maxRomSize));
+            } else {
+                out.resize(std::min(out.size() * 2, maxRomSize));
+            }
+        }
+
+        if (stream.avail_in == 0) {
+            stream.avail_in = static_cast<uInt>(std::min<size_t>(inputLeft, 1u << 30));
+            stream.next_in = const_cast<Bytef*>(input);
+            input += stream.avail_in;
+            inputLeft -= stream.avail_in;
+        }
+
+        size_t outLeft = std::min<size_t>(out.size() - outSize, 1u << 30);
+        stream.next_out = out.data() + outSize;
+        stream.avail_out = static_cast<uInt>(outLeft);
+
+        result = inflate(&stream, Z_NO_FLUSH);
+        outSize += outLeft - stream.avail_out;
+
+        if (result != Z_OK && result != Z_STREAM_END) {
+            break;
+        }
+        if (result == Z_OK && stream.avail_in == 0 && inputLeft == 0 && stream.avail_out > 0) {
+            result = Z_DATA_ERROR; //Truncated stream
+            break;
+        }
+    }
+
+    inflateEnd(&stream);
+    out.resize(outSize);
+    out.shrink_to_fit();
+
+    return result == Z_STREAM_END;
+}
+
+//Finds the entry to load in the central directory : the first .nes file, or the first file
+bool extractZip(ByteSpan zip, const std::string& filename, std::vector<uint8_t>& out)
+{
+    const uint8_t* bytes = zip.data();
+    size_t size = zip.size();
+
+    //End of central directory record, possibly followed by a comment of up to 64KB
+    size_t eocd = size;
+    size_t lowest = size > 22 + 0xFFFF ? size - 22 - 0xFFFF : 0;
+    for (size_t pos = size; pos > lowest && pos >= 22; --pos) {
+        if (readLittleEndian(bytes + pos - 22, 4) == 0x06054B50) {
+            eocd = pos - 22;
+            break;
+        }
+    }
+
+    if (eocd == size) {
+        std::cout << "Bad zip file : " << filename << std::endl;
+        return false;
+    }
+
+    unsigned int nbEntries = readLittleEndian(bytes + eocd + 10, 2);
+    size_t entry = readLittleEndian(bytes + eocd + 16, 4);
+
+    size_t chosen = 0;
+    bool found = false;
+
+    for (unsigned int i = 0; i < nbEntries && entry + 46 <= size; ++i) {
+        if (readLittleEndian(bytes + entry, 4) != 0x02014B50) {
+            break;
+        }
+
+        size_t nameLength = readLittleEndian(bytes + entry + 28, 2);
+        size_t entryLength = 46 + nameLength + readLittleEndian(bytes + entry + 30, 2) + readLittleEndian(bytes + entry + 32, 2);
+        if (entry + 46 + nameLength > size) {
+            break;
+        }
+
+        std::string name(reinterpret_cast<const char*>(bytes + entry + 46), nameLength);
+        bool isFile = !name.empty() && name.back() != '/';
+
+        if (isFile && (!found || endsWith(name, ".nes"))) {
+            chosen = entry;
+            found = true;
+            if (endsWith(name, ".nes")) {
+                break;
+            }
+        }
+
+        entry += entryLength;
+    }
+
+    if (!found) {
+        std::cout << "No ROM in zip file : " << filename << std::endl;
+        return false;
+    }
+
+    unsigned int method = readLittleEndian(bytes + chosen + 10, 2);
+    size_t compressedSize = readLittleEndian(bytes + chosen + 20, 4);
+    size_t uncompressedSize = readLittleEndian(bytes + chosen + 24, 4);
+    size_t local = readLittleEndian(bytes + chosen + 42, 4);
+
+    if (local + 30 > size || readLittleEndian(bytes + local, 4) != 0x04034B50) {
+        std::cout << "Bad zip file : " << filename << std::endl;
+        return false;
+    }
+
+    size_t data = local + 30 + readLittleEndian(bytes + local + 26, 2) + readLittleEndian(bytes + local + 28, 2);
+    if (data + compressedSize > size) {
+        std::cout << "Truncated zip file : " << filename << std::endl;
+        return false;
+    }
+
+    if (method == 0) { //Stored
+        if (compressedSize != uncompressedSize) {
+            std::cout << "Corrupt zip entry : " << filename << std::endl;
+            return false;
+        }
+        out.assign(bytes + data, bytes + data + compressedSize);
+        return true;
+    } else if (method == 8) { //Deflate, without zlib header
+        if (!inflateAll(zip.subspan(data, compressedSize), -MAX_WBITS, uncompressedSize, out) || out.size() != uncompressedSize) {
+            std::cout << "Corrupt zip entry : " << filename << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::cout << "Unsupported zip compression method " << method << " : " << filename << std::endl;
+    return false;
+}
+#endif
+}
+
+RomCompression detectRomCompression(ByteSpan bytes)
+{
+    if (bytes.size() >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B) {
+        return RomCompression::GZIP;
+    } else if (bytes.size() >= 4 && readLittleEndian(bytes.data(), 4) == 0x04034B50) {
+        return RomCompression::ZIP;
+    }
+    return RomCompression::NONE;
+}
+
+bool hasRomExtension(const std::string& path)
+{
+    return endsWith(path, ".nes") || endsWith(path, ".nes.gz") || endsWith(path, ".zip");
+}
+
+const char* romCompressionName(RomCompression compression)
+{
+    switch (compression) {
+    case RomCompression::GZIP:
+        return "gzip";
+    case RomCompression::ZIP:
+        return "zip";
+    default:
+        return "none";
+    }
+}
+
+std::shared_ptr<const RomBuffer> decompressRom(ByteSpan compressed, RomCompression compression, const std::string& filename)
+{
+    TRACE_ZONE("decompressRom");
+
+#ifdef CRNES_ZLIB
+    std::vector<uint8_t> out;
+
+    if (compression == RomCompression::GZIP) {
+        //The gzip trailer has the size, but only modulo 4GB and it could be lying
+        if (!inflateAll(compressed, 16 + MAX_WBITS, 0, out)) {
+            std::cout << "Corrupt gzip file : " << filename << std::endl;
+            return nullptr;
+        }
+    } else if (compression == RomCompression::ZIP) {
+        if (!extractZip(compressed, filename, out)) {
+            return nullptr;
+        }
+    } else {
+        return nullptr;
+    }
+
+    return std::make_shared<const RomBuffer>(std::move(out));
+#else
+    std::cout << "This build can't load compressed ROMs (no zlib) : " << filename << std::endl;
+    return nullptr;
+#endif
+}
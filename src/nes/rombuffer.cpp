@@ -0,0 +1,75 @@
+#include "rombuffer.h"
+
+#include <fstream>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+RomBuffer::RomBuffer()
+    : data(nullptr), size(0), mapping(nullptr)
+{
+
+}
+
+RomBuffer::RomBuffer(std::vector<uint8_t> bytes)
+    : data(nullptr), size(bytes.size()), mapping(nullptr), owned(std::move(bytes))
+{
+    data = owned.data();
+}
+
+RomBuffer::~RomBuffer()
+{
+#ifdef __unix__
+    if (mapping) {
+        munmap(mapping, size);
+    }
+#endif
+}
+
+std::shared_ptr<const RomBuffer> RomBuffer::mapFile(const std::string& filename)
+{
+    std::shared_ptr<RomBuffer> buffer(new RomBuffer());
+
+#ifdef __unix__
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    //The mapping stays valid once the descriptor is closed
+    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+
+    buffer->mapping = mapping;
+    buffer->data = static_cast<const uint8_t*>(mapping);
+    buffer->size = info.st_size;
+#else
+    std::ifstream file(filename, std::ios_base::binary | std::ios_base::ate);
+    if (!file || file.tellg() <= 0) {
+        return nullptr;
+    }
+
+    buffer->owned.resize(file.tellg());
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buffer->owned.data()), buffer->owned.size());
+
+    buffer->data = buffer->owned.data();
+    buffer->size = buffer->owned.size();
+#endif
+
+    return buffer;
+}
@@ -0,0 +1,90 @@
+#include "romcache.h"
+#include "hash.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+std::atomic<bool> cacheEnabled(true);
+
+std::mutex entriesMutex;
+//Collisions are possible, each hash keeps every live image that has it
+std::unordered_multimap<uint64_t, std::weak_ptr<const RomBuffer>> entries;
+
+bool sameContents(ByteSpan a, ByteSpan b)
+{
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+}
+}
+
+void RomCache::setEnabled(bool enabled)
+{
+    cacheEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool RomCache::isEnabled()
+{
+    return cacheEnabled.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<const RomBuffer> RomCache::load(const std::string& filename)
+{
+    std::shared_ptr<const RomBuffer> buffer = RomBuffer::mapFile(filename);
+
+    if (!buffer || !isEnabled()) {
+        return buffer;
+    }
+
+    return intern(std::move(buffer));
+}
+
+std::shared_ptr<const RomBuffer> RomCache::intern(std::shared_ptr<const RomBuffer> buffer)
+{
+    ByteSpan bytes = buffer->getBytes();
+    uint64_t hash = fnv1a64(bytes.data(), bytes.size());
+
+    std::lock_guard<std::mutex> lock(entriesMutex);
+
+    auto range = entries.equal_range(hash);
+    for (auto it = range.first; it != range.second;) {
+        std::shared_ptr<const RomBuffer> cached = it->second.lock();
+
+        if (!cached) {
+            it = entries.erase(it);
+        } else if (sameContents(cached->getBytes(), bytes)) {
+            return cached;
+        } else {
+            ++it;
+        }
+    }
+
+    entries.emplace(hash, buffer);
+    return buffer;
+}
+
+size_t RomCache::getNbImages()
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+
+    size_t nbImages = 0;
+    for (const auto& entry : entries) {
+        nbImages += entry.second.expired() ? 0 : 1;
+    }
+    return nbImages;
+}
+
+size_t RomCache::getNbBytes()
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+
+    size_t nbBytes = 0;
+    for (const auto& entry : entries) {
+        if (std::shared_ptr<const RomBuffer> buffer = entry.second.lock()) {
+            nbBytes += buffer->getBytes().size();
+        }
+    }
+    return nbBytes;
+}
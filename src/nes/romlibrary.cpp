@@ -0,0 +1,324 @@
+#include "romlibrary.h"
+#include "bytestream.h"
+#include "romarchive.h"
+#include "rombuffer.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <thread>
+#include <unordered_set>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+//"CRNESLIB", version, entry count, then the entries back to back, all little endian
+const char indexMagic[8] = {'C', 'R', 'N', 'E', 'S', 'L', 'I', 'B'};
+constexpr uint32_t indexVersion = 2;
+
+enum EntryFlag : uint8_t
+{
+    ENTRY_VALID = 0x01,
+    ENTRY_NES2 = 0x02,
+    ENTRY_BATTERY = 0x04,
+    ENTRY_TRAINER = 0x08,
+    ENTRY_VS_UNISYSTEM = 0x10,
+    ENTRY_PLAYCHOICE = 0x20
+};
+
+std::string normalizePath(const std::string& path)
+{
+    std::error_code error;
+    fs::path absolute = fs::absolute(path, error);
+    return error ? path : absolute.lexically_normal().string();
+}
+
+std::vector<std::string> findRomFiles(const std::vector<std::string>& paths)
+{
+    std::vector<std::string> files;
+
+    for (const auto& path : paths) {
+        std::error_code error;
+
+        if (fs::is_directory(path, error)) {
+            for (const auto& entry : fs::recursive_directory_iterator(path, error)) {
+                if (entry.is_regular_file() && hasRomExtension(entry.path().string())) {
+                    files.push_back(normalizePath(entry.path().string()));
+                }
+            }
+        } else if (fs::is_regular_file(path, error)) {
+            files.push_back(normalizePath(path));
+        } else {
+            std::cout << "File does not exist : " << path << std::endl;
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+//Returns false if the file can't be read or decompressed. bytesHashed is the size of the image.
+bool hashEntry(RomLibraryEntry& entry, uint64_t& bytesHashed)
+{
+    std::shared_ptr<const RomBuffer> buffer = RomBuffer::mapFile(entry.path);
+    if (!buffer) {
+        return false;
+    }
+
+    RomCompression compression = detectRomCompression(buffer->getBytes());
+    if (compression != RomCompression::NONE) {
+        buffer = decompressRom(buffer->getBytes(), compression, entry.path);
+        if (!buffer) {
+            return false;
+        }
+    }
+
+    ByteSpan bytes = buffer->getBytes();
+    bytesHashed = bytes.size();
+    entry.sha1 = sha1(bytes.data(), bytes.size());
+
+    entry.header = INesHeader();
+    entry.valid = parseINesHeader(bytes, entry.header);
+
+    if (entry.valid) {
+        size_t offset = std::min<size_t>(bytes.size(), entry.header.trainer ? 16 + 512 : 16);
+        bytes = bytes.subspan(offset, bytes.size() - offset);
+    }
+
+    entry.crc32c = crc32c(bytes.data(), bytes.size());
+
+    return true;
+}
+}
+
+bool RomLibrary::load(const std::string& filename)
+{
+    entries.clear();
+    pathIndex.clear();
+
+    std::ifstream file(filename, std::ios_base::binary);
+    if (!file) {
+        return true;
+    }
+
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ByteReader reader(ByteSpan(reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+
+    char magic[8];
+    reader.getBytes(magic, sizeof(magic));
+    uint32_t version = reader.get(4);
+    uint32_t nbEntries = reader.get(4);
+
+    if (!reader.isOk() || !std::equal(magic, magic + 8, indexMagic) || version > indexVersion) {
+        std::cout << "Bad ROM index : " << filename << std::endl;
+        return false;
+    } else if (version != indexVersion) {
+        //Older hashes aren't comparable, the next scan hashes every file again
+        std::cout << "Outdated ROM index, rescanning : " << filename << std::endl;
+        return true;
+    }
+
+    for (uint32_t i = 0; i < nbEntries && reader.isOk(); ++i) {
+        RomLibraryEntry entry;
+
+        entry.path.resize(reader.get(2));
+        reader.getBytes(&entry.path[0], entry.path.size());
+        entry.fileSize = reader.get(8);
+        entry.modifiedTime = static_cast<int64_t>(reader.get(8));
+
+        uint8_t flags = reader.get(1);
+        entry.valid = flags & ENTRY_VALID;
+        entry.header.nes2 = flags & ENTRY_NES2;
+        entry.header.battery = flags & ENTRY_BATTERY;
+        entry.header.trainer = flags & ENTRY_TRAINER;
+        entry.header.vsUnisystem = flags & ENTRY_VS_UNISYSTEM;
+        entry.header.playchoice = flags & ENTRY_PLAYCHOICE;
+        entry.header.mirroring = static_cast<Mirroring>(reader.get(1));
+        entry.header.mapperId = reader.get(2);
+        entry.header.nbPrgRom = reader.get(1);
+        entry.header.nbChrRom = reader.get(1);
+
+        entry.crc32c = reader.get(4);
+        reader.getBytes(entry.sha1.data(), entry.sha1.size());
+
+        entries.push_back(std::move(entry));
+    }
+
+    if (!reader.isOk()) {
+        std::cout << "Truncated ROM index : " << filename << std::endl;
+        entries.clear();
+        return false;
+    }
+
+    rebuildPathIndex();
+    return true;
+}
+
+bool RomLibrary::save(const std::string& filename) const
+{
+    ByteWriter writer;
+
+    writer.putBytes(indexMagic, sizeof(indexMagic));
+    writer.put(indexVersion, 4);
+    writer.put(entries.size(), 4);
+
+    for (const auto& entry : entries) {
+        uint8_t flags = (entry.valid ? ENTRY_VALID : 0) | (entry.header.nes2 ? ENTRY_NES2 : 0)
+                      | (entry.header.battery ? ENTRY_BATTERY : 0) | (entry.header.trainer ? ENTRY_TRAINER : 0)
+                      | (entry.header.vsUnisystem ? ENTRY_VS_UNISYSTEM : 0) | (entry.header.playchoice ? ENTRY_PLAYCHOICE : 0);
+
+        writer.put(entry.path.size(), 2);
+        writer.putBytes(entry.path.data(), entry.path.size());
+        writer.put(entry.fileSize, 8);
+        writer.put(static_cast<uint64_t>(entry.modifiedTime), 8);
+        writer.put(flags, 1);
+        writer.put(static_cast<uint8_t>(entry.header.mirroring), 1);
+        writer.put(static_cast<uint16_t>(entry.header.mapperId), 2);
+        writer.put(entry.header.nbPrgRom, 1);
+        writer.put(entry.header.nbChrRom, 1);
+        writer.put(entry.crc32c, 4);
+        writer.putBytes(entry.sha1.data(), entry.sha1.size());
+    }
+
+    std::ofstream file(filename, std::ios_base::binary | std::ios_base::trunc);
+    file.write(reinterpret_cast<const char*>(writer.data.data()), writer.data.size());
+
+    if (!file) {
+        std::cout << "Cannot write ROM index : " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+RomScanStats RomLibrary::scan(const std::vector<std::string>& paths, unsigned int nbThreads)
+{
+    TRACE_ZONE("RomLibrary::scan");
+
+    RomScanStats stats;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::string> files = findRomFiles(paths);
+    std::vector<RomLibraryEntry> scanned;
+    std::vector<size_t> toHash;
+    std::unordered_set<std::string> found;
+
+    for (const auto& path : files) {
+        std::error_code sizeError, timeError;
+        uint64_t fileSize = fs::file_size(path, sizeError);
+        int64_t modifiedTime = fs::last_write_time(path, timeError).time_since_epoch().count();
+
+        if (sizeError || timeError) {
+            ++stats.nbErrors;
+            continue;
+        }
+
+        found.insert(path);
+        auto it = pathIndex.find(path);
+
+        if (it != pathIndex.end() && entries[it->second].fileSize == fileSize && entries[it->second].modifiedTime == modifiedTime) {
+            scanned.push_back(entries[it->second]);
+            ++stats.nbReused;
+        } else {
+            RomLibraryEntry entry;
+            entry.path = path;
+            entry.fileSize = fileSize;
+            entry.modifiedTime = modifiedTime;
+
+            toHash.push_back(scanned.size());
+            scanned.push_back(std::move(entry));
+        }
+    }
+
+    for (const auto& entry : entries) {
+        stats.nbRemoved += found.count(entry.path) ? 0 : 1;
+    }
+
+    //Files are independent, workers take the next one until none are left
+    std::vector<uint8_t> hashed(toHash.size(), 0);
+    std::vector<uint64_t> imageSizes(toHash.size(), 0);
+    std::atomic<size_t> next(0);
+
+    if (nbThreads == 0) {
+        nbThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    nbThreads = std::max<size_t>(1, std::min<size_t>(nbThreads, toHash.size()));
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < nbThreads; ++i) {
+        workers.emplace_back([&]() {
+            for (size_t job = next++; job < toHash.size(); job = next++) {
+                hashed[job] = hashEntry(scanned[toHash[job]], imageSizes[job]);
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    //Files that couldn't be read aren't indexed, the next scan tries them again
+    std::vector<bool> failed(scanned.size(), false);
+    for (size_t job = 0; job < toHash.size(); ++job) {
+        if (!hashed[job]) {
+            failed[toHash[job]] = true;
+            ++stats.nbErrors;
+        } else {
+            stats.bytesHashed += imageSizes[job];
+            ++stats.nbHashed;
+        }
+    }
+
+    entries.clear();
+    for (size_t i = 0; i < scanned.size(); ++i) {
+        if (!failed[i]) {
+            entries.push_back(std::move(scanned[i]));
+        }
+    }
+    rebuildPathIndex();
+
+    stats.nbFiles = entries.size();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+const RomLibraryEntry* RomLibrary::findByPath(const std::string& path) const
+{
+    auto it = pathIndex.find(normalizePath(path));
+    return it != pathIndex.end() ? &entries[it->second] : nullptr;
+}
+
+const RomLibraryEntry* RomLibrary::findBySha1(const Sha1Digest& sha1) const
+{
+    for (const auto& entry : entries) {
+        if (entry.sha1 == sha1) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<const RomLibraryEntry*> RomLibrary::findByCrc32c(uint32_t crc) const
+{
+    std::vector<const RomLibraryEntry*> found;
+    for (const auto& entry : entries) {
+        if (entry.crc32c == crc) {
+            found.push_back(&entry);
+        }
+    }
+    return found;
+}
+
+void RomLibrary::rebuildPathIndex()
+{
+    pathIndex.clear();
+    for (size_t i = 0; i < entries.size(); ++i) {
+        pathIndex[entries[i].path] = i;
+    }
+}
@@ -0,0 +1,136 @@
+#include "saveram.h"
+#include "bytestream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+std::atomic<bool> filesEnabled(true);
+}
+
+void SaveRam::setFilesEnabled(bool enabled)
+{
+    filesEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool SaveRam::areFilesEnabled()
+{
+    return filesEnabled.load(std::memory_order_relaxed);
+}
+
+SaveRam::SaveRam(size_t size)
+    : bytes(nullptr), size(size), dirtyPages(0), mapping(nullptr), owned(size, 0xFF)
+{
+    assert(size <= (size_t(64) << dirtyPageShift));
+    bytes = owned.data();
+}
+
+SaveRam::~SaveRam()
+{
+    flush(true);
+
+#ifdef __unix__
+    if (mapping) {
+        munmap(mapping, size);
+    }
+#endif
+}
+
+bool SaveRam::mapFile(const std::string& filename)
+{
+#ifdef __unix__
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cout << "Cannot open save file : " << filename << std::endl;
+        return false;
+    }
+
+    //A new or short file gets the same contents as RAM at power-up
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    if (static_cast<size_t>(info.st_size) < size) {
+        std::vector<uint8_t> fill(size - info.st_size, 0xFF);
+        if (pwrite(fd, fill.data(), fill.size(), info.st_size) != static_cast<ssize_t>(fill.size())) {
+            std::cout << "Cannot write save file : " << filename << std::endl;
+            close(fd);
+            return false;
+        }
+    }
+
+    void* fileMapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (fileMapping == MAP_FAILED) {
+        std::cout << "Cannot map save file : " << filename << std::endl;
+        return false;
+    }
+
+    mapping = fileMapping;
+    bytes = static_cast<uint8_t*>(fileMapping);
+    owned.clear();
+    owned.shrink_to_fit();
+#else
+    std::ifstream file(filename, std::ios_base::binary);
+    std::fill(owned.begin(), owned.end(), 0xFF);
+    file.read(reinterpret_cast<char*>(owned.data()), owned.size());
+#endif
+
+    this->filename = filename;
+    dirtyPages = 0;
+
+    return true;
+}
+
+void SaveRam::saveState(ByteWriter& writer) const
+{
+    writer.putBytes(bytes, size);
+}
+
+void SaveRam::loadState(ByteReader& reader)
+{
+    reader.getBytes(bytes, size);
+    size_t nbPages = (size + (size_t(1) << dirtyPageShift) - 1) >> dirtyPageShift;
+    dirtyPages = nbPages >= 64 ? ~uint64_t(0) : (uint64_t(1) << nbPages) - 1;
+}
+
+void SaveRam::flush(bool wait)
+{
+    if (dirtyPages == 0 || !isFileBacked()) {
+        dirtyPages = 0;
+        return;
+    }
+
+#ifdef __unix__
+    //msync wants whole system pages, which can be bigger than the dirty pages
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    for (uint64_t pages = dirtyPages; pages != 0; pages &= pages - 1) {
+        size_t start = static_cast<size_t>(__builtin_ctzll(pages)) << dirtyPageShift;
+        size_t end = std::min(size, start + (size_t(1) << dirtyPageShift));
+        start -= start % pageSize;
+
+        msync(bytes + start, end - start, wait ? MS_SYNC : MS_ASYNC);
+    }
+#else
+    //Without mappings the whole file is rewritten
+    std::ofstream file(filename, std::ios_base::binary | std::ios_base::trunc);
+    file.write(reinterpret_cast<const char*>(bytes), size);
+#endif
+
+    dirtyPages = 0;
+}
@@ -0,0 +1,251 @@
+#include "scanlinerenderer.h"
+#include "pixelcompose.h"
+#include "ppu.h"
+#include "ppubus.h"
+#include "trace.h"
+
+#include <algorithm>
+
+namespace
+{
+//2C02 colors as RGB, indexed by the 6 bit values stored in palette RAM
+constexpr uint8_t ntscPalette[64][3] = {
+    { 84,  84,  84}, {  0,  30, 116}, {  8,  16, 144}, { 48,   0, 136}, { 68,   0, 100}, { 92,   0,  48}, { 84,   4,   0}, { 60,  24,   0},
+    { 32,  42,   0}, {  8,  58,   0}, {  0,  64,   0}, {  0,  60,   0}, {  0,  50,  60}, {  0,   0,   0}, {  0,   0,   0}, {  0,   0,   0},
+    {152, 150, 152}, {  8,  76, 196}, { 48,  50, 236}, { 92,  30, 228}, {136,  20, 176}, {160,  20, 100}, {152,  34,  32}, {120,  60,   0},
+    { 84,  90,   0}, { 40, 114,   0}, {  8, 124,   0}, {  0, 118,  40}, {  0, 102, 120}, {  0,   0,   0}, {  0,   0,   0}, {  0,   0,   0},
+    {236, 238, 236}, { 76, 154, 236}, {120, 124, 236}, {176,  98, 236}, {228,  84, 236}, {236,  88, 180}, {236, 106, 100}, {212, 136,  32},
+    {160, 170,   0}, {116, 196,   0}, { 76, 208,  32}, { 56, 204, 108}, { 56, 180, 204}, { 60,  60,  60}, {  0,   0,   0}, {  0,   0,   0},
+    {236, 238, 236}, {168, 204, 236}, {188, 188, 236}, {212, 178, 236}, {236, 174, 236}, {236, 174, 212}, {236, 180, 176}, {228, 196, 144},
+    {204, 210, 120}, {180, 222, 120}, {168, 226, 144}, {152, 226, 180}, {160, 214, 228}, {160, 162, 160}, {  0,   0,   0}, {  0,   0,   0}
+};
+
+constexpr uint8_t spriteBehind = 0x20;
+constexpr uint8_t spriteZero = 0x40;
+
+//OAM indices of the sprites on the line, at most 8 like the hardware
+struct SpriteList
+{
+    uint8_t indices[8];
+    int count;
+    bool overflow;
+};
+
+SpriteList evaluateSprites(const PpuMemory& memory, const PpuLineRegisters& registers, int scanline)
+{
+    SpriteList list;
+    list.count = 0;
+    list.overflow = false;
+
+    int spriteHeight = (registers.ctrl & 0x20) ? 16 : 8;
+
+    for (unsigned int i = 0; i < 64; ++i) {
+        //OAM holds the line before the sprite's first one
+        int row = scanline - 1 - memory.oam[i * 4];
+
+        if (row < 0 || row >= spriteHeight) {
+            continue;
+        }
+
+        if (list.count == 8) {
+            list.overflow = true;
+            break;
+        }
+        list.indices[list.count++] = i;
+    }
+
+    return list;
+}
+
+uint8_t reverseBits(uint8_t bits)
+{
+    bits = ((bits & 0xF0) >> 4) | ((bits & 0x0F) << 4);
+    bits = ((bits & 0xCC) >> 2) | ((bits & 0x33) << 2);
+    return ((bits & 0xAA) >> 1) | ((bits & 0x55) << 1);
+}
+
+//Pattern tile of the sprite's row on the line, row is set to the row inside that tile
+unsigned int spriteTile(const uint8_t* sprite, const PpuLineRegisters& registers, int scanline, unsigned int& row)
+{
+    int spriteHeight = (registers.ctrl & 0x20) ? 16 : 8;
+    int spriteRow = scanline - 1 - sprite[0];
+
+    if (sprite[2] & 0x80) {
+        spriteRow = spriteHeight - 1 - spriteRow;
+    }
+    row = spriteRow & 0x07;
+
+    if (spriteHeight == 16) {
+        return ((sprite[1] & 0x01) ? 256 : 0) + (sprite[1] & 0xFE) + (spriteRow >= 8 ? 1 : 0);
+    }
+    return ((registers.ctrl & 0x08) ? 256 : 0) + sprite[1];
+}
+
+//The 1KB nametable pages the line reads from
+void nametablePages(const PpuMemory& memory, const PpuLineRegisters& registers, const uint8_t* pages[4])
+{
+    for (unsigned int i = 0; i < 4; ++i) {
+        pages[i] = memory.nametables.data() + ((registers.nametableLayout >> (i * 2)) & 0x03) * PpuBus::pageSize;
+    }
+}
+
+//v moved coarse tiles to the right, wrapping into the horizontally adjacent nametable
+uint16_t addCoarseX(uint16_t addr, unsigned int coarse)
+{
+    unsigned int coarseX = (addr & 0x001F) + coarse;
+    return ((addr & ~0x001F) ^ (((coarseX >> 5) & 0x01) << 10)) | (coarseX & 0x001F);
+}
+
+void renderBackground(const PpuMemory& memory, ChrTileCache& tiles, const PpuLineRegisters& registers, uint8_t* line)
+{
+    if (!(registers.mask & 0x08)) {
+        std::fill(line, line + Ppu::width, 0);
+        return;
+    }
+
+    const uint8_t* pages[4];
+    nametablePages(memory, registers, pages);
+
+    //33 tiles so a fine X scroll still covers the whole line
+    std::array<uint8_t, Ppu::width + 8> pixels;
+    uint16_t addr = registers.v;
+    unsigned int fineY = (addr >> 12) & 0x07;
+    unsigned int patternTable = (registers.ctrl & 0x10) ? 256 : 0;
+
+    for (unsigned int tile = 0; tile < 33; ++tile) {
+        const uint8_t* page = pages[(addr >> 10) & 0x03];
+        uint8_t tileId = page[addr & 0x03FF];
+        uint8_t attribute = page[0x03C0 | ((addr >> 4) & 0x38) | ((addr >> 2) & 0x07)];
+        uint8_t paletteBits = ((attribute >> (((addr >> 4) & 0x04) | (addr & 0x02))) & 0x03) << 2;
+
+        const uint8_t* row = tiles.getRow(patternTable + tileId, fineY);
+        for (unsigned int x = 0; x < 8; ++x) {
+            pixels[tile * 8 + x] = row[x] ? (paletteBits | row[x]) : 0;
+        }
+
+        addr = addCoarseX(addr, 1);
+    }
+
+    std::copy(pixels.begin() + registers.fineX, pixels.begin() + registers.fineX + Ppu::width, line);
+
+    if (!(registers.mask & 0x02)) {
+        std::fill(line, line + 8, 0);
+    }
+}
+
+void renderSprites(const PpuMemory& memory, ChrTileCache& tiles, const PpuLineRegisters& registers, int scanline,
+                   const SpriteList& sprites, uint8_t* line)
+{
+    std::fill(line, line + Ppu::width, 0);
+
+    if (!(registers.mask & 0x10)) {
+        return;
+    }
+
+    for (int i = 0; i < sprites.count; ++i) {
+        unsigned int index = sprites.indices[i];
+        const uint8_t* sprite = &memory.oam[index * 4];
+        uint8_t attributes = sprite[2];
+
+        unsigned int row;
+        unsigned int tile = spriteTile(sprite, registers, scanline, row);
+        const uint8_t* pixels = tiles.getRow(tile, row);
+        uint8_t flags = 0x10 | ((attributes & 0x03) << 2) | ((attributes & 0x20) ? spriteBehind : 0) | (index == 0 ? spriteZero : 0);
+        bool flipX = attributes & 0x40;
+
+        //Lower OAM indices are in front, only fill pixels no earlier sprite covers
+        for (int x = 0; x < 8 && sprite[3] + x < Ppu::width; ++x) {
+            uint8_t color = pixels[flipX ? 7 - x : x];
+            uint8_t& out = line[sprite[3] + x];
+
+            if (color && !(out & 0x03)) {
+                out = flags | color;
+            }
+        }
+    }
+
+    if (!(registers.mask & 0x04)) {
+        std::fill(line, line + 8, 0);
+    }
+}
+}
+
+uint32_t paletteColor(uint8_t color)
+{
+    const uint8_t* rgb = ntscPalette[color & 0x3F];
+    return rgb[0] | (rgb[1] << 8) | (rgb[2] << 16) | 0xFF000000u;
+}
+
+uint8_t drawScanline(const PpuMemory& memory, ChrTileCache& tiles,
+                     const PpuLineRegisters& registers, int scanline, uint32_t* out)
+{
+    TRACE_ZONE("drawScanline");
+
+    std::array<uint8_t, Ppu::width> background;
+    std::array<uint8_t, Ppu::width> sprites;
+    std::array<uint32_t, 32> colors;
+
+    SpriteList list = evaluateSprites(memory, registers, scanline);
+    renderBackground(memory, tiles, registers, background.data());
+    renderSprites(memory, tiles, registers, scanline, list, sprites.data());
+
+    uint8_t greyscale = (registers.mask & 0x01) ? 0x30 : 0x3F;
+    for (int i = 0; i < 32; ++i) {
+        colors[i] = paletteColor(memory.palette[i] & greyscale);
+    }
+
+    uint8_t flags = list.overflow ? spriteOverflowFlag : 0;
+    if (composeScanline(background.data(), sprites.data(), colors.data(), out)) {
+        flags |= sprite0HitFlag;
+    }
+    return flags;
+}
+
+uint8_t scanlineStatus(const PpuMemory& memory, ChrTileCache& tiles,
+                       const PpuLineRegisters& registers, int scanline, bool sprite0Hit)
+{
+    SpriteList list = evaluateSprites(memory, registers, scanline);
+    uint8_t flags = list.overflow ? spriteOverflowFlag : 0;
+
+    //Sprite 0 is evaluated first, it's on the line when it's the first one found
+    if (sprite0Hit || list.count == 0 || list.indices[0] != 0 || (registers.mask & 0x18) != 0x18) {
+        return flags;
+    }
+
+    //Opaque pixels of sprite 0's 8 columns and of the background behind them, bit 7 is the leftmost
+    const uint8_t* sprite = &memory.oam[0];
+    unsigned int x = sprite[3];
+
+    unsigned int row;
+    unsigned int tile = spriteTile(sprite, registers, scanline, row);
+    uint8_t spriteOpaque = tiles.getOpaqueMask(tile, row);
+    if (sprite[2] & 0x40) {
+        spriteOpaque = reverseBits(spriteOpaque);
+    }
+
+    //The line starts fineX pixels into the tile at v, the columns cover two tiles from there
+    const uint8_t* pages[4];
+    nametablePages(memory, registers, pages);
+    unsigned int fineY = (registers.v >> 12) & 0x07;
+    unsigned int patternTable = (registers.ctrl & 0x10) ? 256 : 0;
+    unsigned int first = x + registers.fineX;
+
+    uint16_t window = 0;
+    for (unsigned int i = 0; i < 2; ++i) {
+        uint16_t addr = addCoarseX(registers.v, (first >> 3) + i);
+        uint8_t tileId = pages[(addr >> 10) & 0x03][addr & 0x03FF];
+        window = (window << 8) | tiles.getOpaqueMask(patternTable + tileId, fineY);
+    }
+    uint8_t backgroundOpaque = window >> (8 - (first & 0x07));
+
+    //The hardware never reports a hit on the last column, nor in the left 8 pixels when either layer is clipped there
+    unsigned int columns = 0xFF;
+    if (x > Ppu::width - 9) {
+        columns &= 0xFF << (x - (Ppu::width - 9));
+    }
+    if (x < 8 && (registers.mask & 0x06) != 0x06) {
+        columns &= 0xFF >> (8 - x);
+    }
+
+    return (spriteOpaque & backgroundOpaque & columns) ? flags | sprite0HitFlag : flags;
+}
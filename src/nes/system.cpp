@@ -0,0 +1,71 @@
+#include "system.h"
+#include "cpucore.h"
+#include "mapperfactory.h"
+#include "trace.h"
+
+template<class Mapper>
+System<Mapper>::System(std::unique_ptr<Mapper> cartridge, CpuAccuracy accuracy, const std::string& cpuLogFilename)
+    : cartridge(std::move(cartridge)), cpuBus(&cpuRam, this->cartridge.get()),
+      cpu(createCpu(accuracy, &cpuBus, cpuLogFilename))
+{
+    cpuBus.setPpu(&ppu);
+    ppu.setCpu(cpu.get());
+    this->cartridge->setPpuBus(&ppu.getBus());
+}
+
+template<class Mapper>
+uint8_t System<Mapper>::peek(uint16_t addr)
+{
+    if (addr < 0x2000) {
+        return cpuRam.read(addr & 0x07FF);
+    } else if (addr >= 0x6000) {
+        return cartridge->peekCpuBus(addr);
+    }
+
+    return 0;
+}
+
+template<class Mapper>
+void System<Mapper>::saveState(ByteWriter& writer) const
+{
+    cpu->saveState(writer);
+    cpuBus.saveState(writer);
+    cpuRam.saveState(writer);
+    ppu.saveState(writer);
+    cartridge->saveState(writer);
+}
+
+template<class Mapper>
+void System<Mapper>::loadState(ByteReader& reader)
+{
+    cpu->loadState(reader);
+    cpuBus.loadState(reader);
+    cpuRam.loadState(reader);
+    ppu.loadState(reader);
+    cartridge->loadState(reader);
+
+    //The banks and CHR-RAM are only back now, the render threads start over from them
+    cartridge->setPpuBus(&ppu.getBus());
+    ppu.setRenderThreads(ppu.getRenderThreads());
+}
+
+std::unique_ptr<ISystem> loadSystemFromFile(const std::string& filename, CpuAccuracy accuracy,
+                                            const std::string& cpuLogFilename, bool verbose,
+                                            CartridgeLoadStats* stats)
+{
+    TRACE_ZONE("loadSystemFromFile");
+
+    CartridgeImage image;
+    if (!loadCartridgeImage(filename, image, verbose)) {
+        return nullptr;
+    }
+
+    if (stats) {
+        *stats = image.loadStats;
+    }
+
+    return instantiateMapper<std::unique_ptr<ISystem>>(image, [&](auto cartridge) -> std::unique_ptr<ISystem> {
+        using Mapper = typename decltype(cartridge)::element_type;
+        return std::make_unique<System<Mapper>>(std::move(cartridge), accuracy, cpuLogFilename);
+    });
+}
@@ -0,0 +1,156 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+struct TraceEvent
+{
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+struct ThreadBuffer
+{
+    static constexpr size_t maxEvents = 1 << 20;
+
+    unsigned int threadId;
+    std::string threadName;
+    std::vector<TraceEvent> events;
+    uint64_t droppedEvents;
+};
+
+std::atomic<bool> tracingEnabled(false);
+
+//Buffers outlive their thread so worker zones can still be written after a join
+std::mutex buffersMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+ThreadBuffer& threadBuffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.emplace_back(new ThreadBuffer());
+        buffer = buffers.back().get();
+        buffer->threadId = static_cast<unsigned int>(buffers.size());
+        buffer->threadName = "thread " + std::to_string(buffer->threadId);
+        buffer->events.reserve(4096);
+        buffer->droppedEvents = 0;
+    }
+
+    return *buffer;
+}
+
+void writeJsonString(std::ostream& os, const std::string& str)
+{
+    os << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            os << '\\';
+        }
+        os << c;
+    }
+    os << '"';
+}
+}
+
+void Tracer::setEnabled(bool enabled)
+{
+    tracingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Tracer::isEnabled()
+{
+    return tracingEnabled.load(std::memory_order_relaxed);
+}
+
+uint64_t Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer& buffer = threadBuffer();
+
+    if (buffer.events.size() >= ThreadBuffer::maxEvents) {
+        ++buffer.droppedEvents;
+        return;
+    }
+
+    buffer.events.push_back({name, start, end});
+}
+
+void Tracer::setThreadName(const std::string& name)
+{
+    threadBuffer().threadName = name;
+}
+
+void Tracer::clear()
+{
+    std::lock_guard<std::mutex> lock(buffersMutex);
+
+    for (auto& buffer : buffers) {
+        buffer->events.clear();
+        buffer->droppedEvents = 0;
+    }
+}
+
+bool Tracer::writeChromeTrace(const std::string& filename)
+{
+    std::ofstream file(filename);
+
+    if (!file) {
+        std::cout << "Cannot write trace file : " << filename << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+
+    uint64_t origin = UINT64_MAX;
+    for (const auto& buffer : buffers) {
+        for (const auto& event : buffer->events) {
+            origin = std::min(origin, event.start);
+        }
+    }
+
+    //Timestamps are in microseconds relative to the first recorded zone
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+
+    for (const auto& buffer : buffers) {
+        file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+             << ",\"args\":{\"name\":";
+        writeJsonString(file, buffer->threadName);
+        file << "}}";
+        first = false;
+
+        for (const auto& event : buffer->events) {
+            file << ",\n{\"name\":";
+            writeJsonString(file, event.name);
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"ts\":" << (event.start - origin) / 1000.0
+                 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+        }
+
+        if (buffer->droppedEvents > 0) {
+            std::cout << buffer->threadName << " dropped " << buffer->droppedEvents << " trace events" << std::endl;
+        }
+    }
+
+    file << "\n]}\n";
+
+    return static_cast<bool>(file);
+}
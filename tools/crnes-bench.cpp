@@ -0,0 +1,936 @@
+#include "nes.h"
+#include "bootcache.h"
+#include "cartridgemapper001.h"
+#include "cpuprofiler.h"
+#include "perfcounters.h"
+#include "romcache.h"
+#include "saveram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace
+{
+struct Options
+{
+    std::vector<std::string> paths;
+    unsigned int frames = 600;
+    uint64_t cycles = 0;
+    unsigned int warmupFrames = 60;
+    unsigned int repetitions = 5;
+    unsigned int instances = 64;
+    unsigned int renderThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<CpuAccuracy> accuracies = {CpuAccuracy::ACCURATE, CpuAccuracy::FAST};
+    std::string jsonFilename;
+    std::string profileFilename;
+    unsigned int profileInterval = 1000;
+    bool perf = false;
+};
+
+struct MemoryResult
+{
+    std::string rom;
+    unsigned int instances = 0;
+    //0 when the resident set size can't be read
+    double bytesPerInstance = 0.0;
+    double bytesPerInstanceUncached = 0.0;
+    //Whole process with both batches loaded
+    uint64_t residentBytes = 0;
+};
+
+struct Stat
+{
+    double median = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double p99 = 0.0;
+};
+
+//Time to first frame, from loadCartridge to the end of the first frame after warmup
+struct BootResult
+{
+    unsigned int warmupFrames = 0;
+    Stat replayMs;
+    //First boot with an empty cache : replay, then write the snapshot
+    double storeMs = 0.0;
+    Stat snapshotMs;
+    std::string rom;
+    //Every snapshot boot resumed from the snapshot
+    bool usedSnapshot = false;
+    //Otherwise how the first one that didn't went
+    BootSnapshot snapshotBoot = BootSnapshot::LOADED;
+    //The snapshot boot ended in the same state as the replayed one
+    bool matches = false;
+};
+
+//Frame latency, runFrame until the frame is complete, drawing each line inline and on render threads
+struct RenderResult
+{
+    std::string rom;
+    unsigned int nbThreads = 0;
+    Stat inlineUs;
+    Stat threadedUs;
+    //Every frame the threads drew was the same as the inline one
+    bool matches = false;
+};
+
+//Frame time drawing every line and skipping rendering, the status flags are worked out either way
+struct SkipResult
+{
+    std::string rom;
+    Stat renderedUs;
+    Stat skippedUs;
+    //Both machines were in the same state after every frame
+    bool matches = false;
+};
+
+//Host counters over the measured frames, --perf only
+struct PerfResult
+{
+    bool measured = false;
+    double ipc = 0.0;
+    //Per emulated instruction, negative when the host doesn't count the event
+    double branchMisses = -1.0;
+    double l1dMisses = -1.0;
+    double llcMisses = -1.0;
+};
+
+struct RomResult
+{
+    std::string path;
+    CpuAccuracy accuracy = CpuAccuracy::ACCURATE;
+    bool loaded = false;
+    uint64_t framesPerRep = 0;
+    uint64_t cyclesPerRep = 0;
+    uint64_t instructionsPerRep = 0;
+    CartridgeLoadStats loadStats;
+    Stat instructionsPerSec;
+    Stat cyclesPerSec;
+    Stat framesPerSec;
+    Stat frameTimeUs;
+    PerfResult perf;
+#ifdef CRNES_BUS_STATS
+    //BusStats::writeSummary over the measured repetitions
+    std::string busSummary;
+#endif
+};
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedSeconds(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double>(end - start).count();
+}
+
+//Nearest-rank percentile
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0.0;
+    }
+
+    size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+Stat summarize(std::vector<double> values)
+{
+    Stat stat;
+
+    if (values.empty()) {
+        return stat;
+    }
+
+    std::sort(values.begin(), values.end());
+    stat.min = values.front();
+    stat.max = values.back();
+    stat.p99 = percentile(values, 99.0);
+
+    size_t middle = values.size() / 2;
+    stat.median = values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+
+    return stat;
+}
+
+void printUsage()
+{
+    std::cout << "Usage : crnes-bench [options] [rom or directory ...]\n"
+              << "Runs every .nes, .nes.gz and .zip file headless and reports emulation speed. Defaults to testRoms.\n\n"
+              << "  --frames N    frames per repetition (default 600)\n"
+              << "  --cycles N    CPU cycles per repetition, rounded up to whole frames (overrides --frames)\n"
+              << "  --warmup N    frames run before measuring (default 60)\n"
+              << "  --reps N      measured repetitions (default 5)\n"
+              << "  --accuracy T  CPU tier : fast, accurate or both (default both)\n"
+              << "  --instances N instances loaded at once to measure per-instance memory, with and without\n"
+              << "                the ROM cache (default 64, 0 to skip)\n"
+              << "  --render-threads N  render threads the frame latency is compared with (default all cores,\n"
+              << "                0 to skip)\n"
+              << "  --json FILE   also write the results as JSON\n"
+              << "  --profile FILE  profile the CPU on the first ROM and write the report to FILE, folded\n"
+              << "                stacks to FILE.folded and callgrind data to FILE.callgrind\n"
+              << "  --profile-interval N  CPU cycles between profiler samples (default 1000)\n"
+              << "  --perf        read host hardware counters around the measured frames and report IPC and\n"
+              << "                misses per emulated instruction, the counter reads slow those frames a little\n\n"
+              << "The time to first frame of the first ROM that isn't battery-backed is measured replaying\n"
+              << "--warmup frames, and resuming from a boot snapshot taken after them. The frame latency of\n"
+              << "the first ROM is measured drawing each line inline and on --render-threads threads, and\n"
+              << "drawing each line against skipping rendering.\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--help" || arg == "-h") {
+            return false;
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--cycles" && hasValue) {
+            options.cycles = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--warmup" && hasValue) {
+            options.warmupFrames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--reps" && hasValue) {
+            options.repetitions = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--accuracy" && hasValue) {
+            std::string tier = argv[++i];
+            if (tier == "fast") {
+                options.accuracies = {CpuAccuracy::FAST};
+            } else if (tier == "accurate") {
+                options.accuracies = {CpuAccuracy::ACCURATE};
+            } else if (tier != "both") {
+                std::cout << "Unknown accuracy : " << tier << std::endl;
+                return false;
+            }
+        } else if (arg == "--instances" && hasValue) {
+            options.instances = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--render-threads" && hasValue) {
+            options.renderThreads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--json" && hasValue) {
+            options.jsonFilename = argv[++i];
+        } else if (arg == "--profile" && hasValue) {
+            options.profileFilename = argv[++i];
+        } else if (arg == "--profile-interval" && hasValue) {
+            options.profileInterval = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--perf") {
+            options.perf = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cout << "Unknown option : " << arg << std::endl;
+            return false;
+        } else {
+            options.paths.push_back(arg);
+        }
+    }
+
+    if (options.paths.empty()) {
+        options.paths.push_back("testRoms");
+    }
+
+    options.repetitions = std::max(options.repetitions, 1u);
+    options.frames = std::max(options.frames, 1u);
+
+    return true;
+}
+
+std::vector<std::string> findRoms(const std::vector<std::string>& paths)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> roms;
+
+    for (const auto& path : paths) {
+        std::error_code error;
+
+        if (fs::is_directory(path, error)) {
+            for (const auto& entry : fs::recursive_directory_iterator(path, error)) {
+                if (entry.is_regular_file() && hasRomExtension(entry.path().string())) {
+                    roms.push_back(entry.path().string());
+                }
+            }
+        } else if (fs::is_regular_file(path, error)) {
+            roms.push_back(path);
+        } else {
+            std::cout << "File does not exist : " << path << std::endl;
+        }
+    }
+
+    std::sort(roms.begin(), roms.end());
+    return roms;
+}
+
+//Resident set size in bytes, 0 if unknown
+uint64_t residentBytes()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+
+    if (statm >> size >> resident) {
+        return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+//Loads a batch of machines with the same ROM and looks at how much the process grew
+double batchBytesPerInstance(const std::string& path, unsigned int nbInstances, std::vector<std::unique_ptr<Nes>>& machines)
+{
+    uint64_t before = residentBytes();
+
+    for (unsigned int i = 0; i < nbInstances; ++i) {
+        auto nes = std::make_unique<Nes>("");
+        if (!nes->loadCartridge(path, false)) {
+            return 0.0;
+        }
+        nes->runFrame();
+        machines.push_back(std::move(nes));
+    }
+
+    uint64_t after = residentBytes();
+    return before > 0 && after > before ? static_cast<double>(after - before) / nbInstances : 0.0;
+}
+
+//Once without the ROM cache, once with it. The first batch stays alive during the second
+//so the second one can't reuse pages the first one freed.
+MemoryResult measureMemory(const std::string& path, unsigned int nbInstances)
+{
+    MemoryResult result;
+    result.rom = std::filesystem::path(path).filename().string();
+    std::vector<std::unique_ptr<Nes>> machines;
+
+    RomCache::setEnabled(false);
+    result.bytesPerInstanceUncached = batchBytesPerInstance(path, nbInstances, machines);
+    RomCache::setEnabled(true);
+    result.bytesPerInstance = batchBytesPerInstance(path, nbInstances, machines);
+
+    result.instances = nbInstances;
+    result.residentBytes = residentBytes();
+
+    return result;
+}
+
+//Why the snapshot boots of measureBoot didn't all resume from the snapshot
+const char* snapshotBootReason(BootSnapshot snapshotBoot)
+{
+    switch (snapshotBoot) {
+    case BootSnapshot::STORED:
+        return "the snapshot wasn't found";
+    case BootSnapshot::REJECTED:
+        return "loadState rejected the snapshot";
+    case BootSnapshot::BATTERY_BACKED:
+        return "battery-backed ROMs aren't snapshotted";
+    case BootSnapshot::STORE_FAILED:
+        return "the snapshot couldn't be written";
+    default:
+        return "the boot cache was disabled";
+    }
+}
+
+//The first ROM that loads and isn't battery-backed, the only ones the boot cache snapshots.
+//Empty if there is none.
+std::string findBootRom(const std::vector<std::string>& roms)
+{
+    for (const auto& rom : roms) {
+        Nes nes("");
+        if (nes.loadCartridge(rom, false) && !nes.getCartridge()->hasBattery()) {
+            return rom;
+        }
+    }
+    return "";
+}
+
+//Loads the ROM and runs the first frame after warmup. Without the boot cache the warmup is
+//run here, the way Nes::loadCartridge would run it before taking a snapshot.
+double timeToFirstFrame(const std::string& path, CpuAccuracy accuracy, std::vector<uint8_t>& state, BootSnapshot& snapshotBoot)
+{
+    Clock::time_point start = Clock::now();
+
+    Nes nes("", accuracy);
+    if (!nes.loadCartridge(path, false)) {
+        return 0.0;
+    }
+
+    if (!BootCache::isEnabled()) {
+        for (unsigned int frame = 0; frame < BootCache::getWarmupFrames(); ++frame) {
+            nes.runFrame(false);
+        }
+    }
+    nes.runFrame();
+
+    double ms = elapsedSeconds(start, Clock::now()) * 1000.0;
+
+    nes.saveState(state);
+    snapshotBoot = nes.getBootSnapshot();
+    return ms;
+}
+
+//Replays the warmup, then boots once into an empty cache directory and again from the snapshot
+BootResult measureBoot(const std::string& path, CpuAccuracy accuracy, const Options& options)
+{
+    namespace fs = std::filesystem;
+
+    BootResult result;
+    result.warmupFrames = options.warmupFrames;
+    result.rom = std::filesystem::path(path).filename().string();
+
+    std::vector<double> replayMs, snapshotMs;
+    std::vector<uint8_t> replayState, snapshotState;
+    BootSnapshot snapshotBoot = BootSnapshot::NONE;
+
+    BootCache::setWarmupFrames(options.warmupFrames);
+    for (unsigned int rep = 0; rep < options.repetitions; ++rep) {
+        replayMs.push_back(timeToFirstFrame(path, accuracy, replayState, snapshotBoot));
+    }
+
+    std::error_code error;
+    fs::path directory = fs::temp_directory_path(error) / ("crnes-bench-boot-" + std::to_string(std::random_device()()));
+    BootCache::setDirectory(directory.string());
+
+    result.storeMs = timeToFirstFrame(path, accuracy, snapshotState, snapshotBoot);
+    if (snapshotBoot != BootSnapshot::STORED) {
+        result.snapshotBoot = snapshotBoot;
+    }
+
+    for (unsigned int rep = 0; rep < options.repetitions; ++rep) {
+        snapshotMs.push_back(timeToFirstFrame(path, accuracy, snapshotState, snapshotBoot));
+        if (snapshotBoot != BootSnapshot::LOADED && result.snapshotBoot == BootSnapshot::LOADED) {
+            result.snapshotBoot = snapshotBoot;
+        }
+    }
+    result.usedSnapshot = result.snapshotBoot == BootSnapshot::LOADED;
+
+    BootCache::setDirectory("");
+    fs::remove_all(directory, error);
+
+    result.replayMs = summarize(replayMs);
+    result.snapshotMs = summarize(snapshotMs);
+    result.matches = !replayState.empty() && replayState == snapshotState;
+
+    return result;
+}
+
+//Two machines in lockstep, one drawing inline and one on render threads. Each runFrame is timed
+//on its own and the frames are compared.
+RenderResult measureRender(const std::string& path, CpuAccuracy accuracy, const Options& options)
+{
+    RenderResult result;
+    result.rom = std::filesystem::path(path).filename().string();
+    result.nbThreads = options.renderThreads;
+
+    Nes inlineNes("", accuracy);
+    Nes threadedNes("", accuracy);
+    threadedNes.setRenderThreads(options.renderThreads);
+
+    if (!inlineNes.loadCartridge(path, false) || !threadedNes.loadCartridge(path, false)) {
+        return result;
+    }
+
+    for (unsigned int frame = 0; frame < options.warmupFrames; ++frame) {
+        inlineNes.runFrame();
+        threadedNes.runFrame();
+    }
+
+    std::vector<double> inlineUs, threadedUs;
+    size_t frameBytes = Ppu::width * Ppu::height * sizeof(uint32_t);
+    result.matches = true;
+
+    for (unsigned int frame = 0; frame < options.frames * options.repetitions; ++frame) {
+        Clock::time_point start = Clock::now();
+        inlineNes.runFrame();
+        Clock::time_point middle = Clock::now();
+        threadedNes.runFrame();
+        Clock::time_point end = Clock::now();
+
+        inlineUs.push_back(elapsedSeconds(start, middle) * 1e6);
+        threadedUs.push_back(elapsedSeconds(middle, end) * 1e6);
+        result.matches = result.matches && std::memcmp(inlineNes.getPpu().getFrame(), threadedNes.getPpu().getFrame(), frameBytes) == 0;
+    }
+
+    result.inlineUs = summarize(inlineUs);
+    result.threadedUs = summarize(threadedUs);
+
+    return result;
+}
+
+//Two machines in lockstep, one drawing every frame and one skipping rendering. Each runFrame is
+//timed on its own and the states are compared after every frame.
+SkipResult measureRenderSkip(const std::string& path, CpuAccuracy accuracy, const Options& options)
+{
+    SkipResult result;
+    result.rom = std::filesystem::path(path).filename().string();
+
+    Nes renderedNes("", accuracy);
+    Nes skippedNes("", accuracy);
+
+    if (!renderedNes.loadCartridge(path, false) || !skippedNes.loadCartridge(path, false)) {
+        return result;
+    }
+
+    for (unsigned int frame = 0; frame < options.warmupFrames; ++frame) {
+        renderedNes.runFrame();
+        skippedNes.runFrame(false);
+    }
+
+    std::vector<double> renderedUs, skippedUs;
+    std::vector<uint8_t> renderedState, skippedState;
+    result.matches = true;
+
+    for (unsigned int frame = 0; frame < options.frames * options.repetitions; ++frame) {
+        Clock::time_point start = Clock::now();
+        renderedNes.runFrame();
+        Clock::time_point middle = Clock::now();
+        skippedNes.runFrame(false);
+        Clock::time_point end = Clock::now();
+
+        renderedUs.push_back(elapsedSeconds(start, middle) * 1e6);
+        skippedUs.push_back(elapsedSeconds(middle, end) * 1e6);
+
+        renderedNes.saveState(renderedState);
+        skippedNes.saveState(skippedState);
+        result.matches = result.matches && renderedState == skippedState;
+    }
+
+    result.renderedUs = summarize(renderedUs);
+    result.skippedUs = summarize(skippedUs);
+
+    return result;
+}
+
+//Runs the warmup and measured frames of one repetition with a CpuProfiler attached, apart from the
+//timed runs since the profiler slows the CPU down
+bool profileRom(const std::string& path, CpuAccuracy accuracy, const Options& options)
+{
+    Nes nes("", accuracy);
+    if (!nes.loadCartridge(path, false)) {
+        return false;
+    }
+
+    CpuProfiler profiler(options.profileInterval);
+    nes.getCpu().setProfiler(&profiler);
+
+    for (unsigned int frame = 0; frame < options.warmupFrames + options.frames; ++frame) {
+        nes.runFrame(false);
+    }
+    nes.getCpu().setProfiler(nullptr);
+
+    std::ofstream report(options.profileFilename);
+    std::ofstream folded(options.profileFilename + ".folded");
+    std::ofstream callgrind(options.profileFilename + ".callgrind");
+    if (!report || !folded || !callgrind) {
+        std::cout << "Cannot write profile : " << options.profileFilename << std::endl;
+        return false;
+    }
+
+    profiler.writeReport(report);
+    profiler.writeFoldedStacks(folded);
+    profiler.writeCallgrind(callgrind);
+
+    return static_cast<bool>(report) && static_cast<bool>(folded) && static_cast<bool>(callgrind);
+}
+
+PerfResult summarizePerf(const PerfCounters& perfCounters)
+{
+    PerfResult result;
+    uint64_t emulatedInstructions = perfCounters.getEmulatedInstructions(PerfSlice::FRAME);
+    if (emulatedInstructions == 0) {
+        return result;
+    }
+
+    auto perInstruction = [&](PerfCounters::Event event) {
+        if (!perfCounters.isCounted(event)) {
+            return -1.0;
+        }
+        return static_cast<double>(perfCounters.getTotal(PerfSlice::FRAME, event)) / emulatedInstructions;
+    };
+
+    result.measured = true;
+    uint64_t cycles = perfCounters.getTotal(PerfSlice::FRAME, PerfCounters::CYCLES);
+    result.ipc = cycles > 0 ? static_cast<double>(perfCounters.getTotal(PerfSlice::FRAME, PerfCounters::INSTRUCTIONS)) / cycles : 0.0;
+    result.branchMisses = perInstruction(PerfCounters::BRANCH_MISSES);
+    result.l1dMisses = perInstruction(PerfCounters::L1D_MISSES);
+    result.llcMisses = perInstruction(PerfCounters::LLC_MISSES);
+    return result;
+}
+
+//perfCounters is null unless --perf is given and the counters could be opened
+RomResult benchRom(const std::string& path, CpuAccuracy accuracy, const Options& options, PerfCounters* perfCounters)
+{
+    RomResult result;
+    result.path = path;
+    result.accuracy = accuracy;
+
+    Nes nes("", accuracy);
+    if (!nes.loadCartridge(path, accuracy == options.accuracies.front())) {
+        return result;
+    }
+    result.loaded = true;
+    result.loadStats = nes.getLoadStats();
+
+    for (unsigned int frame = 0; frame < options.warmupFrames; ++frame) {
+        nes.runFrame();
+    }
+
+#ifdef CRNES_BUS_STATS
+    nes.getBus().getStats().clear();
+#endif
+    if (perfCounters) {
+        perfCounters->clear();
+        nes.setPerfCounters(perfCounters);
+    }
+
+    std::vector<double> instructionsPerSec, cyclesPerSec, framesPerSec, frameTimesUs;
+
+    for (unsigned int rep = 0; rep < options.repetitions; ++rep) {
+        uint64_t startCycles = nes.getBus().getCycleCount();
+        uint64_t startInstructions = nes.getCpu().getInstructionCount();
+        uint64_t frames = 0;
+
+        Clock::time_point repStart = Clock::now();
+        Clock::time_point frameStart = repStart;
+
+        while (options.cycles > 0 ? nes.getBus().getCycleCount() - startCycles < options.cycles : frames < options.frames) {
+            nes.runFrame();
+            ++frames;
+
+            Clock::time_point frameEnd = Clock::now();
+            frameTimesUs.push_back(elapsedSeconds(frameStart, frameEnd) * 1e6);
+            frameStart = frameEnd;
+        }
+
+        double seconds = elapsedSeconds(repStart, frameStart);
+        uint64_t cycles = nes.getBus().getCycleCount() - startCycles;
+        uint64_t instructions = nes.getCpu().getInstructionCount() - startInstructions;
+
+        instructionsPerSec.push_back(instructions / seconds);
+        cyclesPerSec.push_back(cycles / seconds);
+        framesPerSec.push_back(frames / seconds);
+
+        result.framesPerRep = frames;
+        result.cyclesPerRep = cycles;
+        result.instructionsPerRep = instructions;
+    }
+
+    result.instructionsPerSec = summarize(instructionsPerSec);
+    result.cyclesPerSec = summarize(cyclesPerSec);
+    result.framesPerSec = summarize(framesPerSec);
+    result.frameTimeUs = summarize(frameTimesUs);
+
+    if (perfCounters) {
+        nes.setPerfCounters(nullptr);
+        result.perf = summarizePerf(*perfCounters);
+    }
+
+#ifdef CRNES_BUS_STATS
+    std::ostringstream busSummary;
+    nes.getBus().getStats().writeSummary(busSummary);
+    result.busSummary = busSummary.str();
+#endif
+
+    return result;
+}
+
+void writeJsonString(std::ostream& os, const std::string& str)
+{
+    os << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+void writeJsonStat(std::ostream& os, const char* name, const Stat& stat)
+{
+    os << "\"" << name << "\": {\"median\": " << stat.median << ", \"min\": " << stat.min
+       << ", \"max\": " << stat.max << ", \"p99\": " << stat.p99 << "}";
+}
+
+bool writeJson(const std::string& filename, const Options& options, const MemoryResult& memory, const BootResult& boot,
+               const RenderResult& render, const SkipResult& skip, const std::vector<RomResult>& results)
+{
+    std::ofstream file(filename);
+
+    if (!file) {
+        std::cout << "Cannot write JSON file : " << filename << std::endl;
+        return false;
+    }
+
+    std::time_t now = std::time(nullptr);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    file << std::setprecision(10);
+    file << "{\n"
+         << "  \"timestamp\": \"" << timestamp << "\",\n"
+         << "  \"compiler\": ";
+    writeJsonString(file, __VERSION__);
+    file << ",\n"
+         << "  \"config\": {\"frames\": " << options.frames << ", \"cycles\": " << options.cycles
+         << ", \"warmupFrames\": " << options.warmupFrames << ", \"repetitions\": " << options.repetitions << "},\n"
+         << "  \"memory\": {\"rom\": ";
+    writeJsonString(file, memory.rom);
+    file << ", \"sizeofNes\": " << sizeof(Nes) << ", \"sizeofSystem\": " << sizeof(System<CartridgeMapper001>)
+         << ", \"sizeofCpu\": " << sizeof(CpuCore<CpuAccuracy::ACCURATE, MappedCpuBus<CartridgeMapper001>>)
+         << ", \"instances\": " << memory.instances << ", \"bytesPerInstance\": " << memory.bytesPerInstance
+         << ", \"bytesPerInstanceUncached\": " << memory.bytesPerInstanceUncached << ", \"residentBytes\": " << memory.residentBytes << "},\n"
+         << "  \"boot\": ";
+    if (boot.rom.empty()) {
+        file << "null";
+    } else {
+        file << "{\"rom\": ";
+        writeJsonString(file, boot.rom);
+        file << ", \"warmupFrames\": " << boot.warmupFrames << ", \"storeMs\": " << boot.storeMs
+             << ", \"usedSnapshot\": " << (boot.usedSnapshot ? "true" : "false");
+        if (!boot.usedSnapshot) {
+            file << ", \"noSnapshotReason\": ";
+            writeJsonString(file, snapshotBootReason(boot.snapshotBoot));
+        }
+        file << ", \"matches\": " << (boot.matches ? "true" : "false") << ",\n   ";
+        writeJsonStat(file, "replayMs", boot.replayMs);
+        file << ",\n   ";
+        writeJsonStat(file, "snapshotMs", boot.snapshotMs);
+        file << "}";
+    }
+    file << ",\n"
+         << "  \"render\": {\"rom\": ";
+    writeJsonString(file, render.rom);
+    file << ", \"threads\": " << render.nbThreads << ", \"matches\": " << (render.matches ? "true" : "false") << ",\n   ";
+    writeJsonStat(file, "inlineFrameUs", render.inlineUs);
+    file << ",\n   ";
+    writeJsonStat(file, "threadedFrameUs", render.threadedUs);
+    file << "},\n"
+         << "  \"renderSkip\": {\"rom\": ";
+    writeJsonString(file, skip.rom);
+    file << ", \"matches\": " << (skip.matches ? "true" : "false") << ",\n   ";
+    writeJsonStat(file, "renderedFrameUs", skip.renderedUs);
+    file << ",\n   ";
+    writeJsonStat(file, "skippedFrameUs", skip.skippedUs);
+    file << "},\n"
+         << "  \"roms\": [";
+
+    bool first = true;
+    for (const auto& result : results) {
+        file << (first ? "\n" : ",\n") << "    {\"rom\": ";
+        writeJsonString(file, result.path);
+        file << ", \"accuracy\": \"" << cpuAccuracyName(result.accuracy) << "\"";
+        first = false;
+
+        if (!result.loaded) {
+            file << ", \"error\": \"load failed\"}";
+            continue;
+        }
+
+        file << ", \"framesPerRep\": " << result.framesPerRep
+             << ", \"cyclesPerRep\": " << result.cyclesPerRep
+             << ", \"instructionsPerRep\": " << result.instructionsPerRep
+             << ", \"compression\": \"" << romCompressionName(result.loadStats.compression) << "\""
+             << ", \"loadMs\": " << result.loadStats.totalSeconds * 1000.0
+             << ", \"decompressMs\": " << result.loadStats.decompressSeconds * 1000.0 << ",\n     ";
+        writeJsonStat(file, "instructionsPerSec", result.instructionsPerSec);
+        file << ",\n     ";
+        writeJsonStat(file, "cyclesPerSec", result.cyclesPerSec);
+        file << ",\n     ";
+        writeJsonStat(file, "framesPerSec", result.framesPerSec);
+        file << ",\n     ";
+        writeJsonStat(file, "frameTimeUs", result.frameTimeUs);
+        if (options.perf) {
+            file << ",\n     \"perf\": ";
+            if (result.perf.measured) {
+                auto writeMisses = [&](const char* name, double value) {
+                    file << ", \"" << name << "\": ";
+                    if (value < 0.0) {
+                        file << "null";
+                    } else {
+                        file << value;
+                    }
+                };
+                file << "{\"ipc\": " << result.perf.ipc;
+                writeMisses("branchMissesPerInstruction", result.perf.branchMisses);
+                writeMisses("l1dMissesPerInstruction", result.perf.l1dMisses);
+                writeMisses("llcMissesPerInstruction", result.perf.llcMisses);
+                file << "}";
+            } else {
+                file << "null";
+            }
+        }
+        file << "}";
+    }
+
+    file << "\n  ]\n}\n";
+
+    return static_cast<bool>(file);
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    //Instances of the same ROM would share one save file
+    SaveRam::setFilesEnabled(false);
+
+    std::vector<std::string> roms = findRoms(options.paths);
+    if (roms.empty()) {
+        std::cout << "No ROM found." << std::endl;
+        return 1;
+    }
+
+    MemoryResult memory;
+    if (options.instances > 0) {
+        memory = measureMemory(roms.front(), options.instances);
+    }
+
+    std::cout << "sizeof(Nes) = " << sizeof(Nes) << " bytes, sizeof(System) = " << sizeof(System<CartridgeMapper001>)
+              << " bytes, sizeof(Cpu) = " << sizeof(CpuCore<CpuAccuracy::ACCURATE, MappedCpuBus<CartridgeMapper001>>) << " bytes";
+    if (memory.bytesPerInstance > 0.0) {
+        std::cout << "\n" << std::fixed << std::setprecision(1) << memory.bytesPerInstance / 1024.0
+                  << " KB resident per instance of " << memory.rom << " over " << memory.instances << " instances, "
+                  << memory.bytesPerInstanceUncached / 1024.0 << " KB without the ROM cache, "
+                  << memory.residentBytes / (1024.0 * 1024.0) << " MB resident in total";
+    }
+    std::cout << std::endl;
+
+    BootResult boot;
+    std::string bootRom = findBootRom(roms);
+    std::cout << std::fixed << std::setprecision(3);
+    if (bootRom.empty()) {
+        std::cout << "Time to first frame not measured, every ROM is battery-backed or fails to load" << std::endl;
+    } else {
+        boot = measureBoot(bootRom, options.accuracies.front(), options);
+        std::cout << "Time to first frame of " << boot.rom << " after " << boot.warmupFrames << " warmup frames : "
+                  << boot.replayMs.median << " ms replaying them, " << boot.snapshotMs.median << " ms from a boot snapshot ("
+                  << boot.storeMs << " ms taking it)";
+        if (!boot.usedSnapshot) {
+            std::cout << "\nThe snapshot boots replayed the warmup, " << snapshotBootReason(boot.snapshotBoot);
+        } else if (!boot.matches) {
+            std::cout << "\nThe snapshot boot doesn't end in the same state as the replayed one!";
+        }
+        std::cout << std::endl;
+    }
+
+    RenderResult render;
+    if (options.renderThreads > 0) {
+        render = measureRender(roms.front(), options.accuracies.front(), options);
+        std::cout << "Frame latency of " << render.rom << " on " << render.nbThreads << " render thread(s) : " << render.threadedUs.median << " us p50, "
+                  << render.threadedUs.p99 << " us p99, drawing inline : " << render.inlineUs.median << " us p50, "
+                  << render.inlineUs.p99 << " us p99";
+        if (!render.matches) {
+            std::cout << "\nThe render threads don't draw the same frames as the inline renderer!";
+        }
+        std::cout << std::endl;
+    }
+
+    SkipResult skip = measureRenderSkip(roms.front(), options.accuracies.front(), options);
+    std::cout << "Frame time of " << skip.rom << " skipping rendering : " << skip.skippedUs.median << " us p50, " << skip.skippedUs.p99
+              << " us p99, drawing every line : " << skip.renderedUs.median << " us p50, " << skip.renderedUs.p99 << " us p99";
+    if (!skip.matches) {
+        std::cout << "\nSkipping rendering doesn't leave the machine in the same state!";
+    }
+    std::cout << std::endl;
+
+    if (!options.profileFilename.empty() && profileRom(roms.front(), options.accuracies.front(), options)) {
+        std::cout << "CPU profile of " << std::filesystem::path(roms.front()).filename().string() << " written to "
+                  << options.profileFilename << " (.folded, .callgrind)" << std::endl;
+    }
+
+    std::unique_ptr<PerfCounters> perfCounters;
+    if (options.perf) {
+        perfCounters = std::make_unique<PerfCounters>();
+        if (!perfCounters->isAvailable()) {
+            perfCounters.reset();
+        }
+    }
+
+    std::vector<RomResult> results;
+    for (const auto& rom : roms) {
+        for (CpuAccuracy accuracy : options.accuracies) {
+            results.push_back(benchRom(rom, accuracy, options, perfCounters.get()));
+        }
+    }
+
+    //Medians over the repetitions, frame time percentiles over every measured frame
+    std::cout << "\n" << std::left << std::setw(36) << "ROM" << std::setw(10) << "CPU" << std::right
+              << std::setw(12) << "MIPS" << std::setw(12) << "MCycles/s" << std::setw(10) << "FPS"
+              << std::setw(14) << "Frame us p50" << std::setw(14) << "Frame us p99";
+    if (perfCounters) {
+        //Host events over the measured frames, misses per emulated instruction
+        std::cout << std::setw(8) << "IPC" << std::setw(15) << "BrMiss/EmuIns" << std::setw(16) << "L1DMiss/EmuIns"
+                  << std::setw(16) << "LLCMiss/EmuIns";
+    }
+    std::cout << "\n";
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& result : results) {
+        std::string name = std::filesystem::path(result.path).filename().string();
+        std::cout << std::left << std::setw(36) << name.substr(0, 35) << std::setw(10) << cpuAccuracyName(result.accuracy) << std::right;
+
+        if (!result.loaded) {
+            std::cout << "  load failed\n";
+            continue;
+        }
+
+        std::cout << std::setw(12) << result.instructionsPerSec.median / 1e6
+                  << std::setw(12) << result.cyclesPerSec.median / 1e6
+                  << std::setw(10) << result.framesPerSec.median
+                  << std::setw(14) << result.frameTimeUs.median
+                  << std::setw(14) << result.frameTimeUs.p99;
+        if (perfCounters) {
+            auto printMisses = [](int width, double value) {
+                std::cout << std::setw(width);
+                if (value < 0.0) {
+                    std::cout << "-";
+                } else {
+                    std::cout << std::setprecision(4) << value << std::setprecision(2);
+                }
+            };
+            std::cout << std::setw(8) << result.perf.ipc;
+            printMisses(15, result.perf.branchMisses);
+            printMisses(16, result.perf.l1dMisses);
+            printMisses(16, result.perf.llcMisses);
+        }
+        std::cout << "\n";
+    }
+
+#ifdef CRNES_BUS_STATS
+    for (const auto& result : results) {
+        if (result.loaded) {
+            std::cout << "\nBus accesses of " << std::filesystem::path(result.path).filename().string()
+                      << " (" << cpuAccuracyName(result.accuracy) << ")\n" << result.busSummary;
+        }
+    }
+#endif
+
+    if (!options.jsonFilename.empty() && !writeJson(options.jsonFilename, options, memory, boot, render, skip, results)) {
+        return 1;
+    }
+
+    return 0;
+}
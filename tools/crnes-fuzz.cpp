@@ -0,0 +1,759 @@
+#include "cpucore.h"
+#include "cpuram.h"
+#include "cpubus.h"
+#include "cartridgemapper.h"
+
+#include "refcpu6502.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+//Programs are laid out in PRG-RAM and end with an undocumented opcode, which ends the case
+//when it is reached. BRK and the reset vector both point back to the program.
+constexpr uint16_t programStart = 0x6000;
+constexpr uint8_t terminator = 0x02;
+
+enum class Field { PC, A, X, Y, S, P, WRITES, CYCLES, COUNT };
+
+const char* fieldNames[] = {"PC", "A", "X", "Y", "S", "P", "writes", "cycles"};
+
+constexpr unsigned int nbSignatures = 0x100 * static_cast<unsigned int>(Field::COUNT);
+
+struct Options
+{
+    unsigned int nbThreads = 0;
+    double seconds = 10.0;
+    uint64_t maxCases = 0;
+    uint64_t seed = 0;
+    unsigned int length = 32;
+    bool compareCycles = true;
+    CpuAccuracy accuracy = CpuAccuracy::ACCURATE;
+    unsigned int maxReports = 20;
+    std::string outDir = "fuzz-out";
+    std::string replayFilename;
+};
+
+//xorshift64*, fast enough to refill RAM for every case
+class Random
+{
+public:
+    explicit Random(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+
+    uint64_t next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    uint8_t byte() { return static_cast<uint8_t>(next() >> 56); }
+    unsigned int below(unsigned int n) { return static_cast<unsigned int>((next() >> 32) % n); }
+
+    void fill(uint8_t* data, size_t size)
+    {
+        for (size_t i = 0; i < size; i += 8) {
+            uint64_t value = next();
+            std::memcpy(data + i, &value, std::min<size_t>(8, size - i));
+        }
+    }
+
+private:
+    uint64_t state;
+};
+
+uint64_t mix(uint64_t a, uint64_t b)
+{
+    uint64_t x = a ^ (b + 0x9E3779B97F4A7C15ULL + (a << 6) + (a >> 2));
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    return x;
+}
+
+struct TestCase
+{
+    uint64_t caseSeed = 0;
+    //0 leaves RAM and PRG-RAM cleared
+    uint64_t memorySeed = 0;
+    CpuRegisters registers = {programStart, 0, 0, 0, 0xFD, 0x24};
+    std::vector<std::vector<uint8_t>> program;
+};
+
+struct Mismatch
+{
+    Field field;
+    uint8_t opcode;
+    unsigned int step;
+    std::string description;
+
+    unsigned int signature() const { return opcode * static_cast<unsigned int>(Field::COUNT) + static_cast<unsigned int>(field); }
+    //Cycle counts don't feed back into the state, both models can keep running after a cycle mismatch
+    bool diverged() const { return field != Field::CYCLES; }
+};
+
+//PRG-ROM shared by every machine : random bytes with the reset and BRK vectors on the program
+const std::shared_ptr<const RomBuffer>& fuzzPrgRom()
+{
+    static const std::shared_ptr<const RomBuffer> prgRom = []() {
+        std::vector<uint8_t> rom(0x8000);
+        Random(0xC0FFEE).fill(rom.data(), rom.size());
+        rom[0x7FFC] = rom[0x7FFE] = programStart & 0xFF;
+        rom[0x7FFD] = rom[0x7FFF] = programStart >> 8;
+        return std::make_shared<const RomBuffer>(std::move(rom));
+    }();
+
+    return prgRom;
+}
+
+CartridgeImage fuzzCartridgeImage()
+{
+    CartridgeImage image;
+    image.mirroring = Mirroring::VERTICAL;
+    image.buffer = fuzzPrgRom();
+    image.prgRom = image.buffer->getBytes();
+    return image;
+}
+
+//NROM-like board with PRG-RAM contents the fuzzer can reset in one copy
+class FuzzCartridge final : public CartridgeMapper
+{
+public:
+    std::array<uint8_t, 0x2000> prgRam;
+
+    FuzzCartridge() : CartridgeMapper(fuzzCartridgeImage()) {}
+
+    uint8_t readCpuBus(uint16_t addr, BusAccess) override { return peekCpuBus(addr); }
+
+    void writeCpuBus(uint16_t addr, uint8_t data) override
+    {
+        if (addr >= 0x6000 && addr < 0x8000) {
+            prgRam[addr - 0x6000] = data;
+        }
+    }
+
+    uint8_t peekCpuBus(uint16_t addr) const override
+    {
+        if (addr < 0x6000) {
+            return 0;
+        }
+        return addr < 0x8000 ? prgRam[addr - 0x6000] : prgRom[addr - 0x8000];
+    }
+};
+
+//Logs every CPU write, whatever device it ends up in. The CPU is instantiated on this class,
+//so it calls this write directly.
+class FuzzBus : public MappedCpuBus<FuzzCartridge>
+{
+public:
+    using MappedCpuBus<FuzzCartridge>::MappedCpuBus;
+
+    std::vector<RefWrite> writes;
+
+    void write(uint16_t addr, uint8_t data)
+    {
+        writes.push_back({addr, data});
+        MappedCpuBus<FuzzCartridge>::write(addr, data);
+    }
+};
+
+struct Machine
+{
+    CpuRam ram;
+    FuzzCartridge cartridge;
+    FuzzBus bus;
+    std::unique_ptr<Cpu> cpu;
+
+    RefMemory refMemory;
+    RefCpu6502 ref;
+
+    explicit Machine(CpuAccuracy accuracy) : bus(&ram, &cartridge), cpu(createCpu(accuracy, &bus, "")), ref(refMemory)
+    {
+        refMemory.prgRom = fuzzPrgRom()->getBytes().data();
+        bus.writes.reserve(16);
+        refMemory.writes.reserve(16);
+    }
+
+    void load(const TestCase& testCase)
+    {
+        if (testCase.memorySeed) {
+            Random random(testCase.memorySeed);
+            random.fill(refMemory.ram, sizeof(refMemory.ram));
+            random.fill(refMemory.prgRam, sizeof(refMemory.prgRam));
+        } else {
+            std::memset(refMemory.ram, 0, sizeof(refMemory.ram));
+            std::memset(refMemory.prgRam, 0, sizeof(refMemory.prgRam));
+        }
+
+        uint16_t addr = programStart - 0x6000;
+        for (const auto& instruction : testCase.program) {
+            for (uint8_t byte : instruction) {
+                refMemory.prgRam[addr++] = byte;
+            }
+        }
+        refMemory.prgRam[addr] = terminator;
+
+        for (uint16_t i = 0; i < sizeof(refMemory.ram); ++i) {
+            ram.write(i, refMemory.ram[i]);
+        }
+        std::memcpy(cartridge.prgRam.data(), refMemory.prgRam, sizeof(refMemory.prgRam));
+
+        const CpuRegisters& registers = testCase.registers;
+        cpu->setRegisters(registers);
+        ref.state = {registers.PC, registers.A, registers.X, registers.Y, registers.S, registers.P};
+    }
+};
+
+std::string hex(unsigned int value, int width)
+{
+    std::ostringstream os;
+    os << std::uppercase << std::hex << std::setfill('0') << std::setw(width) << value;
+    return os.str();
+}
+
+std::string describeState(uint16_t PC, uint8_t A, uint8_t X, uint8_t Y, uint8_t S, uint8_t P,
+                          const std::vector<RefWrite>& writes, unsigned int cycles)
+{
+    std::string text = "PC=$" + hex(PC, 4) + " A=$" + hex(A, 2) + " X=$" + hex(X, 2) + " Y=$" + hex(Y, 2)
+                       + " S=$" + hex(S, 2) + " P=$" + hex(P, 2) + " cycles=" + std::to_string(cycles) + " writes=[";
+
+    for (size_t i = 0; i < writes.size(); ++i) {
+        text += (i ? " $" : "$") + hex(writes[i].addr, 4) + "=$" + hex(writes[i].data, 2);
+    }
+
+    return text + "]";
+}
+
+//onMismatch returns true to stop the case. Returns the number of instructions executed.
+unsigned int runCase(Machine& machine, const TestCase& testCase, const Options& options,
+                     const std::function<bool(const Mismatch&)>& onMismatch, std::ostream* trace = nullptr)
+{
+    machine.load(testCase);
+
+    unsigned int maxSteps = std::max<unsigned int>(testCase.program.size(), 1) * 4;
+    unsigned int step = 0;
+
+    for (; step < maxSteps; ++step) {
+        uint16_t PC = machine.ref.state.PC;
+        uint8_t opcode = machine.refMemory.read(PC);
+
+        if (!RefCpu6502::isDocumented(opcode)) {
+            break;
+        }
+
+        //Taken before the instruction runs, it may overwrite itself
+        uint8_t bytes[3] = {opcode, machine.refMemory.read(PC + 1), machine.refMemory.read(PC + 2)};
+
+        machine.bus.writes.clear();
+        machine.refMemory.writes.clear();
+
+        uint64_t startCycle = machine.bus.getCycleCount();
+        machine.cpu->tick();
+        unsigned int cpuCycles = static_cast<unsigned int>(machine.bus.getCycleCount() - startCycle);
+        unsigned int refCycles = machine.ref.step();
+
+        CpuRegisters cpu = machine.cpu->getRegisters();
+        const RefState& ref = machine.ref.state;
+
+        Field field = Field::COUNT;
+        if (cpu.PC != ref.PC) {
+            field = Field::PC;
+        } else if (cpu.A != ref.A) {
+            field = Field::A;
+        } else if (cpu.X != ref.X) {
+            field = Field::X;
+        } else if (cpu.Y != ref.Y) {
+            field = Field::Y;
+        } else if (cpu.S != ref.S) {
+            field = Field::S;
+        } else if ((cpu.P ^ ref.P) & 0xCF) { //Bits 4 and 5 don't exist in the register
+            field = Field::P;
+        } else if (!(machine.bus.writes == machine.refMemory.writes)) {
+            field = Field::WRITES;
+        } else if (options.compareCycles && cpuCycles != refCycles) {
+            field = Field::CYCLES;
+        }
+
+        if (trace || field != Field::COUNT) {
+            std::string cpuState = describeState(cpu.PC, cpu.A, cpu.X, cpu.Y, cpu.S, cpu.P, machine.bus.writes, cpuCycles);
+            std::string refState = describeState(ref.PC, ref.A, ref.X, ref.Y, ref.S, ref.P, machine.refMemory.writes, refCycles);
+
+            if (trace) {
+                *trace << std::setw(4) << step << "  $" << hex(PC, 4) << " " << std::left << std::setw(16)
+                       << RefCpu6502::disassemble(bytes, PC) << std::right
+                       << (field != Field::COUNT ? std::string("  MISMATCH ") + fieldNames[static_cast<int>(field)] : "") << "\n"
+                       << "      cpu " << cpuState << "\n"
+                       << "      ref " << refState << "\n";
+            }
+
+            if (field != Field::COUNT) {
+                Mismatch mismatch{field, opcode, step, ""};
+                mismatch.description = std::string(fieldNames[static_cast<int>(field)]) + " mismatch on "
+                                        + RefCpu6502::instruction(opcode).mnemonic + " (opcode $" + hex(opcode, 2) + ", $" + hex(PC, 4) + " "
+                                        + RefCpu6502::disassemble(bytes, PC) + ") at step " + std::to_string(step) + "\n"
+                                        + "cpu " + cpuState + "\nref " + refState;
+
+                if (onMismatch(mismatch)) {
+                    return step + 1;
+                }
+            }
+        }
+    }
+
+    return step;
+}
+
+TestCase generateCase(uint64_t caseSeed, const Options& options)
+{
+    static const std::vector<uint8_t> documented = []() {
+        std::vector<uint8_t> opcodes;
+        for (unsigned int opcode = 0; opcode < 0x100; ++opcode) {
+            if (RefCpu6502::isDocumented(opcode)) {
+                opcodes.push_back(opcode);
+            }
+        }
+        return opcodes;
+    }();
+
+    Random random(caseSeed);
+    TestCase testCase;
+
+    testCase.caseSeed = caseSeed;
+    testCase.memorySeed = random.next() | 1;
+    testCase.registers = {programStart, random.byte(), random.byte(), random.byte(), random.byte(), random.byte()};
+
+    for (unsigned int i = 0; i < options.length; ++i) {
+        uint8_t opcode = documented[random.below(documented.size())];
+        std::vector<uint8_t> instruction = {opcode};
+
+        for (unsigned int byte = 1; byte < RefCpu6502::length(opcode); ++byte) {
+            instruction.push_back(random.byte());
+        }
+
+        RefCpu6502::Mode mode = RefCpu6502::instruction(opcode).mode;
+        unsigned int choice = random.below(4);
+
+        //Keep most jumps, branches and absolute accesses close to the program and RAM so the
+        //cases don't all wander off into PRG-ROM
+        if ((opcode == 0x4C || opcode == 0x20) && choice != 0) {
+            uint16_t target = programStart + random.below(options.length * 2);
+            instruction[1] = target & 0xFF;
+            instruction[2] = target >> 8;
+        } else if (mode == RefCpu6502::REL && choice != 0) {
+            instruction[1] = static_cast<uint8_t>(static_cast<int>(random.below(32)) - 16);
+        } else if ((mode == RefCpu6502::ABS || mode == RefCpu6502::ABX || mode == RefCpu6502::ABY) && choice >= 2) {
+            instruction[2] &= 0x07;
+        }
+
+        testCase.program.push_back(instruction);
+    }
+
+    return testCase;
+}
+
+//Whether the case still shows a mismatch with the given signature
+bool reproduces(Machine& machine, const TestCase& testCase, const Options& options, unsigned int signature)
+{
+    bool found = false;
+
+    runCase(machine, testCase, options, [&](const Mismatch& mismatch) {
+        found = mismatch.signature() == signature;
+        return found || mismatch.diverged();
+    });
+
+    return found;
+}
+
+//Greedily drops instructions, then simplifies memory and registers, as long as the mismatch remains
+TestCase minimize(Machine& machine, TestCase testCase, const Options& options, unsigned int signature)
+{
+    bool changed = true;
+
+    for (unsigned int pass = 0; changed && pass < 8; ++pass) {
+        changed = false;
+
+        for (size_t i = testCase.program.size(); i-- > 0;) {
+            TestCase candidate = testCase;
+            candidate.program.erase(candidate.program.begin() + i);
+
+            if (reproduces(machine, candidate, options, signature)) {
+                testCase = candidate;
+                changed = true;
+            }
+        }
+
+        std::vector<std::function<void(TestCase&)>> simplifications = {
+            [](TestCase& c) { c.memorySeed = 0; },
+            [](TestCase& c) { c.registers.A = 0; },
+            [](TestCase& c) { c.registers.X = 0; },
+            [](TestCase& c) { c.registers.Y = 0; },
+            [](TestCase& c) { c.registers.S = 0xFD; },
+            [](TestCase& c) { c.registers.P = 0x24; },
+        };
+
+        for (const auto& simplify : simplifications) {
+            TestCase candidate = testCase;
+            simplify(candidate);
+
+            const CpuRegisters& a = candidate.registers;
+            const CpuRegisters& b = testCase.registers;
+            if (a.A == b.A && a.X == b.X && a.Y == b.Y && a.S == b.S && a.P == b.P && candidate.memorySeed == testCase.memorySeed) {
+                continue;
+            }
+
+            if (reproduces(machine, candidate, options, signature)) {
+                testCase = candidate;
+                changed = true;
+            }
+        }
+    }
+
+    return testCase;
+}
+
+bool saveReproducer(const std::string& filename, const TestCase& testCase, const Mismatch& mismatch)
+{
+    std::ofstream file(filename);
+
+    if (!file) {
+        std::cout << "Cannot write reproducer : " << filename << std::endl;
+        return false;
+    }
+
+    std::istringstream description(mismatch.description);
+    std::string line;
+
+    file << "# crnes-fuzz reproducer, replay with crnes-fuzz --replay " << filename << "\n";
+    while (std::getline(description, line)) {
+        file << "# " << line << "\n";
+    }
+
+    const CpuRegisters& registers = testCase.registers;
+    file << "case-seed " << testCase.caseSeed << "\n"
+         << "memory-seed " << testCase.memorySeed << "\n"
+         << "registers " << hex(registers.PC, 4) << " " << hex(registers.A, 2) << " " << hex(registers.X, 2) << " "
+         << hex(registers.Y, 2) << " " << hex(registers.S, 2) << " " << hex(registers.P, 2) << "\n";
+
+    uint16_t PC = programStart;
+    for (const auto& instruction : testCase.program) {
+        std::string bytes;
+        for (uint8_t byte : instruction) {
+            bytes += hex(byte, 2) + " ";
+        }
+
+        uint8_t padded[3] = {instruction[0], instruction.size() > 1 ? instruction[1] : uint8_t(0), instruction.size() > 2 ? instruction[2] : uint8_t(0)};
+        file << "insn " << std::left << std::setw(10) << bytes << std::right << "# $" << hex(PC, 4) << " "
+             << RefCpu6502::disassemble(padded, PC) << "\n";
+        PC += instruction.size();
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool loadReproducer(const std::string& filename, TestCase& testCase)
+{
+    std::ifstream file(filename);
+
+    if (!file) {
+        std::cout << "File does not exist : " << filename << std::endl;
+        return false;
+    }
+
+    testCase = TestCase();
+    std::string line;
+
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream is(line);
+        std::string keyword;
+
+        if (!(is >> keyword)) {
+            continue;
+        }
+
+        if (keyword == "case-seed") {
+            is >> testCase.caseSeed;
+        } else if (keyword == "memory-seed") {
+            is >> testCase.memorySeed;
+        } else if (keyword == "registers") {
+            unsigned int values[6];
+            for (auto& value : values) {
+                is >> std::hex >> value;
+            }
+            testCase.registers = {static_cast<uint16_t>(values[0]), static_cast<uint8_t>(values[1]), static_cast<uint8_t>(values[2]),
+                                  static_cast<uint8_t>(values[3]), static_cast<uint8_t>(values[4]), static_cast<uint8_t>(values[5])};
+        } else if (keyword == "insn") {
+            std::vector<uint8_t> instruction;
+            unsigned int byte;
+            while (is >> std::hex >> byte) {
+                instruction.push_back(static_cast<uint8_t>(byte));
+            }
+            if (!instruction.empty()) {
+                testCase.program.push_back(instruction);
+            }
+        } else {
+            std::cout << "Bad reproducer line : " << line << std::endl;
+            return false;
+        }
+
+        if (is.fail() && !is.eof()) {
+            std::cout << "Bad reproducer line : " << line << std::endl;
+            return false;
+        }
+    }
+
+    return !testCase.program.empty();
+}
+
+int replay(const Options& options)
+{
+    TestCase testCase;
+    if (!loadReproducer(options.replayFilename, testCase)) {
+        return 1;
+    }
+
+    Machine machine(options.accuracy);
+    bool mismatched = false;
+
+    runCase(machine, testCase, options, [&](const Mismatch& mismatch) {
+        mismatched = true;
+        return mismatch.diverged();
+    }, &std::cout);
+
+    std::cout << (mismatched ? "Mismatch reproduced." : "No mismatch.") << std::endl;
+    return mismatched ? 1 : 0;
+}
+
+class Fuzzer
+{
+public:
+    explicit Fuzzer(const Options& options) : options(options)
+    {
+        for (auto& reported : reportedSignatures) {
+            reported = false;
+        }
+    }
+
+    std::atomic<uint64_t> nbCases{0};
+    std::atomic<uint64_t> nbInstructions{0};
+    std::atomic<unsigned int> nbReports{0};
+    std::atomic<bool> stop{false};
+
+    void work()
+    {
+        Machine machine(options.accuracy);
+        std::vector<Mismatch> found;
+
+        //Cheap filter in front of the shared flags, most mismatches are repeats
+        std::array<bool, nbSignatures> seen;
+        seen.fill(false);
+
+        const uint64_t batch = 64;
+
+        while (!stop) {
+            uint64_t first = nextCase.fetch_add(batch);
+            uint64_t instructions = 0;
+            uint64_t cases = 0;
+
+            for (uint64_t index = first; index < first + batch; ++index) {
+                if (options.maxCases && index >= options.maxCases) {
+                    stop = true;
+                    break;
+                }
+
+                TestCase testCase = generateCase(mix(options.seed, index), options);
+
+                found.clear();
+                instructions += runCase(machine, testCase, options, [&](const Mismatch& mismatch) {
+                    if (!seen[mismatch.signature()]) {
+                        seen[mismatch.signature()] = true;
+                        found.push_back(mismatch);
+                    }
+                    return mismatch.diverged();
+                });
+
+                for (const auto& mismatch : found) {
+                    report(machine, testCase, mismatch);
+                }
+                ++cases;
+            }
+
+            nbCases += cases;
+            nbInstructions += instructions;
+        }
+    }
+
+private:
+    const Options& options;
+    std::atomic<uint64_t> nextCase{0};
+    std::array<std::atomic<bool>, nbSignatures> reportedSignatures;
+    std::mutex outputMutex;
+
+    void report(Machine& machine, const TestCase& testCase, const Mismatch& mismatch)
+    {
+        if (reportedSignatures[mismatch.signature()].exchange(true) || nbReports >= options.maxReports) {
+            return;
+        }
+
+        TestCase minimized = minimize(machine, testCase, options, mismatch.signature());
+
+        //Get the description from the minimized case
+        Mismatch minimizedMismatch = mismatch;
+        runCase(machine, minimized, options, [&](const Mismatch& other) {
+            if (other.signature() == mismatch.signature()) {
+                minimizedMismatch = other;
+                return true;
+            }
+            return other.diverged();
+        });
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+
+        if (nbReports >= options.maxReports) {
+            return;
+        }
+        unsigned int reportId = ++nbReports;
+
+        std::string filename = (std::filesystem::path(options.outDir)
+                                / ("mismatch-" + std::to_string(reportId) + "-" + RefCpu6502::instruction(mismatch.opcode).mnemonic
+                                   + "-" + hex(mismatch.opcode, 2) + "-" + fieldNames[static_cast<int>(mismatch.field)] + ".txt")).string();
+        saveReproducer(filename, minimized, minimizedMismatch);
+
+        std::cout << "\n" << minimizedMismatch.description << "\n"
+                  << "  " << minimized.program.size() << " instruction(s), saved to " << filename << std::endl;
+
+        if (nbReports >= options.maxReports) {
+            stop = true;
+        }
+    }
+};
+
+void printUsage()
+{
+    std::cout << "Usage : crnes-fuzz [options]\n"
+              << "Runs random 6502 programs on Cpu and on a reference model, compares them after every instruction.\n\n"
+              << "  --threads N      worker threads (default all cores)\n"
+              << "  --seconds S      time budget (default 10)\n"
+              << "  --cases N        stop after N cases\n"
+              << "  --seed N         base seed (default from the clock)\n"
+              << "  --length N       instructions per case (default 32)\n"
+              << "  --no-cycles      don't compare cycle counts\n"
+              << "  --fast           fuzz the fast CPU tier instead of the accurate one\n"
+              << "  --max-reports N  stop after N distinct mismatches (default 20)\n"
+              << "  --out DIR        where reproducers are saved (default fuzz-out)\n"
+              << "  --replay FILE    run a reproducer and trace every instruction\n";
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    options.seed = std::chrono::steady_clock::now().time_since_epoch().count();
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--threads" && hasValue) {
+            options.nbThreads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--seconds" && hasValue) {
+            options.seconds = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--cases" && hasValue) {
+            options.maxCases = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--length" && hasValue) {
+            options.length = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--no-cycles") {
+            options.compareCycles = false;
+        } else if (arg == "--fast") {
+            options.accuracy = CpuAccuracy::FAST;
+        } else if (arg == "--max-reports" && hasValue) {
+            options.maxReports = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--out" && hasValue) {
+            options.outDir = argv[++i];
+        } else if (arg == "--replay" && hasValue) {
+            options.replayFilename = argv[++i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (!options.replayFilename.empty()) {
+        return replay(options);
+    }
+
+    //Programs have to fit in PRG-RAM along with the terminator
+    options.length = std::min(options.length, 0x1FFFu / 3);
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(options.outDir, error) && !std::filesystem::create_directories(options.outDir, error)) {
+        std::cout << "Cannot create output directory : " << options.outDir << std::endl;
+        return 1;
+    }
+
+    unsigned int nbThreads = options.nbThreads > 0 ? options.nbThreads : std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "Fuzzing with seed " << options.seed << " on " << nbThreads << " threads"
+              << (options.compareCycles ? "" : ", cycles not compared") << std::endl;
+
+    Fuzzer fuzzer(options);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < nbThreads; ++i) {
+        workers.emplace_back([&fuzzer]() { fuzzer.work(); });
+    }
+
+    double seconds = 0.0;
+    uint64_t lastInstructions = 0;
+
+    while (!fuzzer.stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (now >= options.seconds) {
+            fuzzer.stop = true;
+        }
+
+        if (static_cast<unsigned int>(now) != static_cast<unsigned int>(seconds) || fuzzer.stop) {
+            uint64_t instructions = fuzzer.nbInstructions;
+            std::cout << "[" << std::fixed << std::setprecision(1) << now << "s] " << fuzzer.nbCases << " cases, "
+                      << instructions << " instructions, " << std::setprecision(2)
+                      << (instructions - lastInstructions) / std::max(now - seconds, 1e-3) / 1e6 << " M instr/s, "
+                      << fuzzer.nbReports << " mismatch(es)" << std::endl;
+            lastInstructions = instructions;
+            seconds = now;
+        }
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\n" << fuzzer.nbCases << " cases, " << fuzzer.nbInstructions << " instructions in " << std::setprecision(2)
+              << totalSeconds << "s (" << fuzzer.nbInstructions / totalSeconds / 1e6 << " M instr/s), "
+              << fuzzer.nbReports << " distinct mismatch(es)" << std::endl;
+
+    return fuzzer.nbReports > 0 ? 1 : 0;
+}
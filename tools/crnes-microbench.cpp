@@ -0,0 +1,415 @@
+#include "cpucore.h"
+#include "cpuram.h"
+#include "cpubus.h"
+#include "cartridgemapper001.h"
+#include "pixelcompose.h"
+#include "ppu.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+//Synthetic programs run from CPU RAM : the body is repeated from $0300 up to $07F0, followed by JMP $0300
+constexpr uint16_t programStart = 0x0300;
+constexpr uint16_t programEnd = 0x07F0;
+
+volatile uint8_t sink;
+
+struct Options
+{
+    unsigned int samples = 20;
+    double minSampleMs = 10.0;
+    std::string filter;
+    unsigned int composeChecks = 0;
+};
+
+struct Benchmark
+{
+    std::string name;
+    //Runs the benchmark for the given number of iterations and returns the number of operations done
+    std::function<uint64_t(uint64_t)> run;
+};
+
+struct Result
+{
+    double meanNs;
+    double medianNs;
+    double ci95Ns;
+    double stddevNs;
+};
+
+CartridgeImage makeCartridgeImage()
+{
+    std::vector<uint8_t> prgRom(0x4000);
+
+    //Arbitrary but non-constant contents so reads can't be folded
+    for (unsigned int i = 0; i < prgRom.size(); ++i) {
+        prgRom[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    //Reset vector, mirrored at $FFFC
+    prgRom[0x3FFC] = programStart & 0xFF;
+    prgRom[0x3FFD] = programStart >> 8;
+
+    CartridgeImage image;
+    image.mapperId = 0;
+    image.mirroring = Mirroring::VERTICAL;
+    image.buffer = std::make_shared<RomBuffer>(std::move(prgRom));
+    image.prgRom = image.buffer->getBytes();
+
+    return image;
+}
+
+struct Machine
+{
+    CpuRam ram;
+    CartridgeMapper001 cartridge;
+    MappedCpuBus<CartridgeMapper001> bus;
+    //Same devices seen through the CartridgeMapper vtable, for comparison
+    MappedCpuBus<CartridgeMapper> virtualBus;
+    std::unique_ptr<Cpu> cpu;
+
+    Machine(CpuAccuracy accuracy = CpuAccuracy::ACCURATE)
+        : cartridge(makeCartridgeImage()),
+          bus(&ram, &cartridge), virtualBus(&ram, &cartridge), cpu(createCpu(accuracy, &bus, ""))
+    {
+
+    }
+
+    void loadProgram(const std::vector<uint8_t>& prologue, const std::vector<uint8_t>& body)
+    {
+        uint16_t addr = programStart;
+
+        for (auto byte : prologue) {
+            bus.write(addr++, byte);
+        }
+
+        uint16_t loopStart = addr;
+        while (addr + body.size() + 3 <= programEnd) {
+            for (auto byte : body) {
+                bus.write(addr++, byte);
+            }
+        }
+
+        bus.write(addr++, 0x4C);
+        bus.write(addr++, loopStart & 0xFF);
+        bus.write(addr++, loopStart >> 8);
+
+        //Reset and run the prologue
+        cpu->tick();
+        for (unsigned int i = 0; i < prologue.size(); ++i) {
+            cpu->tick();
+        }
+    }
+};
+
+//Same program on both CPU tiers. Iterations are CPU cycles, given to run() like Nes does, and ops are instructions
+void addCpuBenchmarks(std::vector<Benchmark>& benchmarks, const std::string& name, std::vector<uint8_t> prologue, std::vector<uint8_t> body)
+{
+    for (CpuAccuracy accuracy : {CpuAccuracy::ACCURATE, CpuAccuracy::FAST}) {
+        auto machine = std::make_shared<Machine>(accuracy);
+        machine->loadProgram(prologue, body);
+
+        benchmarks.push_back({name + " [" + cpuAccuracyName(accuracy) + "]", [machine](uint64_t iterations) {
+            uint64_t startInstructions = machine->cpu->getInstructionCount();
+            machine->cpu->run(machine->bus.getCycleCount() + iterations);
+            return machine->cpu->getInstructionCount() - startInstructions;
+        }});
+    }
+}
+
+template<class Bus>
+Benchmark busBenchmark(const std::string& name, Bus Machine::* bus, uint16_t base, uint16_t mask)
+{
+    auto machine = std::make_shared<Machine>();
+
+    return {name, [machine, bus, base, mask](uint64_t iterations) {
+        Bus& mediator = (*machine).*bus;
+        uint8_t acc = 0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            acc += mediator.read(base + (i & mask));
+        }
+        sink = acc;
+        return iterations;
+    }};
+}
+
+//Layers in the encoding Ppu hands composeScanline, with sprite 0 and priority bits on random pixels
+struct ComposeLine
+{
+    std::array<uint8_t, Ppu::width> background;
+    std::array<uint8_t, Ppu::width> sprites;
+    std::array<uint32_t, 32> colors;
+};
+
+ComposeLine randomComposeLine(std::mt19937& rng)
+{
+    ComposeLine line;
+    //Sparse or dense sprites, and lines where only one pixel can hit
+    unsigned int spriteDensity = rng() % 4;
+    unsigned int sprite0Density = rng() % 3 == 0 ? 0 : rng() % 16;
+
+    for (int x = 0; x < Ppu::width; ++x) {
+        line.background[x] = rng() & 0x0F;
+        line.sprites[x] = rng() % 4 < spriteDensity ? (0x10 | (rng() & 0x2F)) : 0;
+        if (sprite0Density > 0 && rng() % 16 < sprite0Density) {
+            line.sprites[x] |= 0x40;
+        }
+    }
+    if (sprite0Density == 0) {
+        line.sprites[rng() % Ppu::width] |= 0x53;
+    }
+
+    for (auto& color : line.colors) {
+        color = rng();
+    }
+    return line;
+}
+
+//Every kernel the CPU runs against the scalar one, pixel by pixel and for the sprite 0 hit
+int checkCompose(unsigned int nbLines)
+{
+    std::mt19937 rng(0x4E45531A);
+    std::array<uint32_t, Ppu::width> expected;
+    std::array<uint32_t, Ppu::width> actual;
+    int result = 0;
+
+    for (ComposeKernel kernel : {ComposeKernel::SSSE3, ComposeKernel::AVX2}) {
+        if (!isComposeKernelSupported(kernel)) {
+            std::cout << "compose/" << composeKernelName(kernel) << " : not supported by this CPU" << std::endl;
+            continue;
+        }
+
+        unsigned int nbMismatches = 0;
+        for (unsigned int i = 0; i < nbLines; ++i) {
+            ComposeLine line = randomComposeLine(rng);
+            bool expectedHit = composeScanline(ComposeKernel::SCALAR, line.background.data(), line.sprites.data(), line.colors.data(), expected.data());
+            bool actualHit = composeScanline(kernel, line.background.data(), line.sprites.data(), line.colors.data(), actual.data());
+
+            if (expectedHit != actualHit || expected != actual) {
+                if (nbMismatches == 0) {
+                    int x = std::mismatch(expected.begin(), expected.end(), actual.begin()).first - expected.begin();
+                    std::cout << "compose/" << composeKernelName(kernel) << " : line " << i << " differs, sprite 0 hit "
+                              << expectedHit << " vs " << actualHit;
+                    if (x < Ppu::width) {
+                        std::cout << ", first at x = " << x << " (bg $" << std::hex << static_cast<int>(line.background[x])
+                                  << ", sprite $" << static_cast<int>(line.sprites[x]) << std::dec << ")";
+                    }
+                    std::cout << std::endl;
+                }
+                ++nbMismatches;
+            }
+        }
+
+        std::cout << "compose/" << composeKernelName(kernel) << " : " << nbLines - nbMismatches << "/" << nbLines << " lines match scalar" << std::endl;
+        if (nbMismatches > 0) {
+            result = 1;
+        }
+    }
+
+    return result;
+}
+
+std::vector<Benchmark> makeBenchmarks()
+{
+    std::vector<Benchmark> benchmarks;
+
+    //LDX #$20, LDY #$20, pointers at $10 -> $02F0 and $12 -> $0280
+    const std::vector<uint8_t> indexSetup = {
+        0xA2, 0x20, 0xA0, 0x20,
+        0xA9, 0xF0, 0x85, 0x10, 0xA9, 0x02, 0x85, 0x11,
+        0xA9, 0x80, 0x85, 0x12, 0xA9, 0x02, 0x85, 0x13
+    };
+
+    //Dispatch : one-byte implied instructions, then a mix that defeats the branch predictor
+    addCpuBenchmarks(benchmarks, "dispatch/implied (INX)", {}, {0xE8});
+    addCpuBenchmarks(benchmarks, "dispatch/mixed", {}, {
+        0xA9, 0x12, 0x69, 0x34, 0xE8, 0x29, 0x7F, 0x88, 0x09, 0x01, 0xAA,
+        0x49, 0x55, 0xC9, 0x20, 0x18, 0xA8, 0xE9, 0x03, 0x8A, 0x38, 0x98
+    });
+
+    //Addressing modes, LDA in every case
+    addCpuBenchmarks(benchmarks, "am/zeroPage", indexSetup, {0xA5, 0x40});
+    addCpuBenchmarks(benchmarks, "am/absolute", indexSetup, {0xAD, 0x80, 0x02});
+    addCpuBenchmarks(benchmarks, "am/absoluteX", indexSetup, {0xBD, 0x80, 0x02});
+    addCpuBenchmarks(benchmarks, "am/absoluteX page cross", indexSetup, {0xBD, 0xF0, 0x02});
+    addCpuBenchmarks(benchmarks, "am/indexedIndirect", indexSetup, {0xA1, 0xF0});
+    addCpuBenchmarks(benchmarks, "am/indirectIndexed", indexSetup, {0xB1, 0x12});
+    addCpuBenchmarks(benchmarks, "am/indirectIndexed page cross", indexSetup, {0xB1, 0x10});
+
+    //CpuBus::read per region
+    benchmarks.push_back(busBenchmark("bus/read RAM", &Machine::bus, 0x0000, 0x1FFF));
+    benchmarks.push_back(busBenchmark("bus/read PPU registers", &Machine::bus, 0x2000, 0x1FFF));
+    benchmarks.push_back(busBenchmark("bus/read APU/IO", &Machine::bus, 0x4000, 0x001F));
+    benchmarks.push_back(busBenchmark("bus/read PRG-RAM", &Machine::bus, 0x6000, 0x1FFF));
+    benchmarks.push_back(busBenchmark("bus/read PRG-ROM", &Machine::bus, 0x8000, 0x7FFF));
+    benchmarks.push_back(busBenchmark("bus/read PRG-ROM [virtual mapper]", &Machine::virtualBus, 0x8000, 0x7FFF));
+
+    //The mapper alone
+    auto machine = std::make_shared<Machine>();
+    benchmarks.push_back({"mapper001/readCpuBus", [machine](uint64_t iterations) {
+        uint8_t acc = 0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            acc += machine->cartridge.readCpuBus(0x8000 + (i & 0x7FFF), BusAccess::DATA);
+        }
+        sink = acc;
+        return iterations;
+    }});
+
+    //Scanline composition, ops are lines of 256 pixels
+    for (ComposeKernel kernel : {ComposeKernel::SCALAR, ComposeKernel::SSSE3, ComposeKernel::AVX2}) {
+        if (!isComposeKernelSupported(kernel)) {
+            continue;
+        }
+
+        std::mt19937 rng(kernel == ComposeKernel::SCALAR ? 1 : 2);
+        auto lines = std::make_shared<std::vector<ComposeLine>>();
+        for (int i = 0; i < 64; ++i) {
+            lines->push_back(randomComposeLine(rng));
+        }
+
+        benchmarks.push_back({std::string("ppu/composeScanline [") + composeKernelName(kernel) + "]", [lines, kernel](uint64_t iterations) {
+            std::array<uint32_t, Ppu::width> out;
+            uint8_t acc = 0;
+            for (uint64_t i = 0; i < iterations; ++i) {
+                const ComposeLine& line = (*lines)[i & 63];
+                acc += composeScanline(kernel, line.background.data(), line.sprites.data(), line.colors.data(), out.data());
+                acc += static_cast<uint8_t>(out[i & 0xFF]);
+            }
+            sink = acc;
+            return iterations;
+        }});
+    }
+
+    return benchmarks;
+}
+
+//Two-sided 95% Student t quantile
+double tQuantile95(unsigned int degreesOfFreedom)
+{
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+
+    if (degreesOfFreedom == 0) {
+        return 0.0;
+    }
+    return degreesOfFreedom <= 30 ? table[degreesOfFreedom - 1] : 1.960;
+}
+
+double runTimed(const Benchmark& benchmark, uint64_t iterations, uint64_t& ops)
+{
+    Clock::time_point start = Clock::now();
+    ops = benchmark.run(iterations);
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+Result measure(const Benchmark& benchmark, const Options& options)
+{
+    uint64_t ops = 0;
+
+    //Grow the sample size until one sample lasts at least minSampleMs, which also warms up caches
+    uint64_t iterations = 1000;
+    while (runTimed(benchmark, iterations, ops) < options.minSampleMs * 1e6 && iterations < (1ULL << 40)) {
+        iterations *= 2;
+    }
+
+    std::vector<double> nsPerOp;
+    for (unsigned int sample = 0; sample < options.samples; ++sample) {
+        double ns = runTimed(benchmark, iterations, ops);
+        nsPerOp.push_back(ns / ops);
+    }
+
+    double mean = 0.0;
+    for (double value : nsPerOp) {
+        mean += value;
+    }
+    mean /= nsPerOp.size();
+
+    double variance = 0.0;
+    for (double value : nsPerOp) {
+        variance += (value - mean) * (value - mean);
+    }
+    variance /= nsPerOp.size() > 1 ? nsPerOp.size() - 1 : 1;
+
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    size_t middle = nsPerOp.size() / 2;
+
+    Result result;
+    result.meanNs = mean;
+    result.medianNs = nsPerOp.size() % 2 ? nsPerOp[middle] : (nsPerOp[middle - 1] + nsPerOp[middle]) / 2.0;
+    result.stddevNs = std::sqrt(variance);
+    result.ci95Ns = tQuantile95(nsPerOp.size() - 1) * result.stddevNs / std::sqrt(static_cast<double>(nsPerOp.size()));
+
+    return result;
+}
+
+void printUsage()
+{
+    std::cout << "Usage : crnes-microbench [--samples N] [--min-time MS] [--filter TEXT] [--check-compose LINES]\n"
+              << "Reports ns/op for the CPU dispatch, addressing modes, CpuBus reads, the mapper and scanline composition.\n"
+              << "--check-compose only compares the SIMD composition kernels with the scalar one on random lines.\n";
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--samples" && hasValue) {
+            options.samples = std::max(2ul, std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--min-time" && hasValue) {
+            options.minSampleMs = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--check-compose" && hasValue) {
+            options.composeChecks = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (options.composeChecks > 0) {
+        return checkCompose(options.composeChecks);
+    }
+
+    std::cout << std::left << std::setw(42) << "Benchmark" << std::right
+              << std::setw(12) << "ns/op" << std::setw(12) << "+/- 95%" << std::setw(12) << "median"
+              << std::setw(12) << "stddev" << "\n";
+    std::cout << std::fixed << std::setprecision(3);
+
+    for (const auto& benchmark : makeBenchmarks()) {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+
+        Result result = measure(benchmark, options);
+
+        std::cout << std::left << std::setw(42) << benchmark.name << std::right
+                  << std::setw(12) << result.meanNs << std::setw(12) << result.ci95Ns
+                  << std::setw(12) << result.medianNs << std::setw(12) << result.stddevNs << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "romlibrary.h"
+#include "hash.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    std::vector<std::string> paths;
+    std::string indexFilename = "crnes-library.idx";
+    unsigned int nbThreads = 0;
+    bool rescan = false;
+    bool list = false;
+    std::string find;
+};
+
+const char* mirroringName(Mirroring mirroring)
+{
+    switch (mirroring) {
+    case Mirroring::VERTICAL:
+        return "V";
+    case Mirroring::HORIZONTAL:
+        return "H";
+    case Mirroring::FOUR_SCREEN:
+        return "4";
+    default:
+        return "?";
+    }
+}
+
+std::string crcHex(uint32_t crc)
+{
+    uint8_t bytes[4] = {static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16),
+                        static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc)};
+    return toHex(bytes, 4);
+}
+
+void printEntry(const RomLibraryEntry& entry)
+{
+    std::cout << crcHex(entry.crc32c) << "  " << toHex(entry.sha1.data(), entry.sha1.size()) << "  ";
+
+    if (entry.valid) {
+        std::cout << std::setw(3) << entry.header.mapperId << std::setw(5) << static_cast<unsigned int>(entry.header.nbPrgRom)
+                  << std::setw(5) << static_cast<unsigned int>(entry.header.nbChrRom) << "  " << mirroringName(entry.header.mirroring)
+                  << (entry.header.nes2 ? " 2.0" : "    ") << (entry.header.battery ? " B" : "  ");
+    } else {
+        std::cout << "  not an iNES file      ";
+    }
+
+    std::cout << "  " << entry.path << "\n";
+}
+
+bool parseHex(const std::string& text, std::vector<uint8_t>& bytes)
+{
+    if (text.size() % 2 != 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < text.size(); i += 2) {
+        char* end = nullptr;
+        std::string digits = text.substr(i, 2);
+        bytes.push_back(static_cast<uint8_t>(std::strtoul(digits.c_str(), &end, 16)));
+        if (*end != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+//CRC32C with 8 hex digits, SHA-1 with 40
+int find(const RomLibrary& library, const std::string& hash)
+{
+    std::vector<uint8_t> bytes;
+    std::vector<const RomLibraryEntry*> found;
+
+    if (!parseHex(hash, bytes) || (bytes.size() != 4 && bytes.size() != 20)) {
+        std::cout << "Expected a CRC32C (8 hex digits) or a SHA-1 (40 hex digits) : " << hash << std::endl;
+        return 1;
+    }
+
+    if (bytes.size() == 4) {
+        found = library.findByCrc32c((bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3]);
+    } else {
+        Sha1Digest sha1;
+        std::copy(bytes.begin(), bytes.end(), sha1.begin());
+        if (const RomLibraryEntry* entry = library.findBySha1(sha1)) {
+            found.push_back(entry);
+        }
+    }
+
+    for (const RomLibraryEntry* entry : found) {
+        printEntry(*entry);
+    }
+
+    return found.empty() ? 1 : 0;
+}
+
+void printUsage()
+{
+    std::cout << "Usage : crnes-scan [options] [rom or directory ...]\n"
+              << "Indexes the header and the CRC32C/SHA-1 of every .nes, .nes.gz and .zip file (default testRoms).\n"
+              << "Files whose size and modification time didn't change keep their indexed entry.\n\n"
+              << "  --index FILE  index to update (default crnes-library.idx)\n"
+              << "  --threads N   hashing threads (default all cores)\n"
+              << "  --rescan      ignore the existing index and hash everything\n"
+              << "  --list        print every entry : CRC32C, SHA-1, mapper, PRG and CHR banks, mirroring\n"
+              << "  --find HASH   only look HASH up in the index, without scanning\n";
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--index" && hasValue) {
+            options.indexFilename = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            options.nbThreads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--rescan") {
+            options.rescan = true;
+        } else if (arg == "--list") {
+            options.list = true;
+        } else if (arg == "--find" && hasValue) {
+            options.find = argv[++i];
+        } else if (arg.compare(0, 2, "--") == 0 || arg == "-h") {
+            printUsage();
+            return 1;
+        } else {
+            options.paths.push_back(arg);
+        }
+    }
+
+    RomLibrary library;
+    if (!options.rescan && !library.load(options.indexFilename)) {
+        return 1;
+    }
+
+    if (!options.find.empty()) {
+        return find(library, options.find);
+    }
+
+    if (options.paths.empty()) {
+        options.paths.push_back("testRoms");
+    }
+
+    RomScanStats stats = library.scan(options.paths, options.nbThreads);
+
+    if (!library.save(options.indexFilename)) {
+        return 1;
+    }
+
+    if (options.list) {
+        for (const auto& entry : library.getEntries()) {
+            printEntry(entry);
+        }
+        std::cout << "\n";
+    }
+
+    double megabytes = stats.bytesHashed / (1024.0 * 1024.0);
+    std::cout << stats.nbFiles << " ROM(s) indexed in " << std::fixed << std::setprecision(2) << stats.seconds << "s : "
+              << stats.nbHashed << " hashed (" << megabytes << " MB, "
+              << (stats.seconds > 0.0 ? megabytes / stats.seconds : 0.0) << " MB/s), "
+              << stats.nbReused << " unchanged, " << stats.nbRemoved << " removed, " << stats.nbErrors << " unreadable\n"
+              << "CRC32C : " << (hasHardwareCrc32c() ? "SSE4.2" : "table") << ", SHA-1 : "
+              << (hasHardwareSha1() ? "SHA extensions" : "portable") << std::endl;
+
+    return stats.nbErrors == 0 ? 0 : 1;
+}
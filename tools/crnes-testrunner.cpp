@@ -0,0 +1,309 @@
+#include "nes.h"
+#include "prgcoverage.h"
+#include "saveram.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+//blargg's test ROMs report through PRG-RAM :
+//  $6000       status, $80 while running, $81 when the ROM wants a reset, result code otherwise
+//  $6001-$6003 signature DE B0 61, written once the status byte is valid
+//  $6004       NUL terminated text output
+constexpr uint16_t statusAddr = 0x6000;
+constexpr uint16_t textAddr = 0x6004;
+constexpr uint8_t statusRunning = 0x80;
+constexpr uint8_t statusNeedsReset = 0x81;
+
+//The ROMs ask for the reset to be delayed by at least 100ms
+constexpr unsigned int resetDelayFrames = 7;
+
+enum class Outcome { PASS, FAIL, TIMEOUT, LOAD_ERROR };
+
+struct Options
+{
+    std::vector<std::string> paths;
+    unsigned int timeoutFrames = 60 * 60;
+    unsigned int nbThreads = 0;
+    std::string coverageDir;
+    //Merge mode, the paths are the coverage files
+    std::string mergedCoverage;
+};
+
+struct TestResult
+{
+    std::string path;
+    Outcome outcome = Outcome::LOAD_ERROR;
+    int resultCode = -1;
+    uint64_t frames = 0;
+    double seconds = 0.0;
+    std::string message;
+};
+
+bool hasSignature(Nes& nes)
+{
+    return nes.peek(0x6001) == 0xDE && nes.peek(0x6002) == 0xB0 && nes.peek(0x6003) == 0x61;
+}
+
+std::string readText(Nes& nes)
+{
+    std::string text;
+
+    for (uint16_t addr = textAddr; addr < 0x8000; ++addr) {
+        char c = static_cast<char>(nes.peek(addr));
+        if (c == '\0') {
+            break;
+        }
+        text += c;
+    }
+
+    return text;
+}
+
+TestResult runTest(const std::string& path, const Options& options)
+{
+    TestResult result;
+    result.path = path;
+
+    auto start = std::chrono::steady_clock::now();
+
+    Nes nes("");
+    if (!nes.loadCartridge(path, false)) {
+        return result;
+    }
+
+    if (!options.coverageDir.empty()) {
+        nes.getCartridge()->enableCoverage();
+    }
+
+    result.outcome = Outcome::TIMEOUT;
+    unsigned int resetCountdown = 0;
+
+    //The results are read from RAM, nothing needs drawing
+    while (result.frames < options.timeoutFrames) {
+        nes.runFrame(false);
+        ++result.frames;
+
+        if (resetCountdown > 0) {
+            if (--resetCountdown == 0) {
+                nes.reset();
+            }
+            continue;
+        }
+
+        if (!hasSignature(nes)) {
+            continue;
+        }
+
+        uint8_t status = nes.peek(statusAddr);
+        if (status == statusRunning) {
+            continue;
+        } else if (status == statusNeedsReset) {
+            resetCountdown = resetDelayFrames;
+            continue;
+        }
+
+        result.resultCode = status;
+        result.outcome = status == 0 ? Outcome::PASS : Outcome::FAIL;
+        break;
+    }
+
+    if (hasSignature(nes)) {
+        result.message = readText(nes);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!options.coverageDir.empty()) {
+        std::string name = std::filesystem::path(path).filename().string();
+        nes.getCartridge()->getPrgCoverage()->save((std::filesystem::path(options.coverageDir) / (name + ".cov")).string());
+    }
+
+    return result;
+}
+
+std::vector<std::string> findRoms(const std::vector<std::string>& paths)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> roms;
+
+    for (const auto& path : paths) {
+        std::error_code error;
+
+        if (fs::is_directory(path, error)) {
+            for (const auto& entry : fs::recursive_directory_iterator(path, error)) {
+                if (entry.is_regular_file() && hasRomExtension(entry.path().string())) {
+                    roms.push_back(entry.path().string());
+                }
+            }
+        } else if (fs::is_regular_file(path, error)) {
+            roms.push_back(path);
+        } else {
+            std::cout << "File does not exist : " << path << std::endl;
+        }
+    }
+
+    std::sort(roms.begin(), roms.end());
+    return roms;
+}
+
+const char* outcomeName(const TestResult& result)
+{
+    switch (result.outcome) {
+    case Outcome::PASS:
+        return "PASS";
+    case Outcome::FAIL:
+        return "FAIL";
+    case Outcome::TIMEOUT:
+        return "TIMEOUT";
+    default:
+        return "LOAD ERROR";
+    }
+}
+
+std::string firstLine(const std::string& text)
+{
+    std::string line = text.substr(0, text.find('\n'));
+    return line.size() > 48 ? line.substr(0, 45) + "..." : line;
+}
+
+//OR's coverage files of the same ROM together, from runs in parallel or one after the other
+int mergeCoverage(const Options& options)
+{
+    if (options.paths.empty()) {
+        std::cout << "No coverage file to merge." << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<PrgCoverage> merged = PrgCoverage::loadFile(options.paths.front());
+    if (!merged) {
+        return 1;
+    }
+
+    for (size_t i = 1; i < options.paths.size(); ++i) {
+        if (!merged->mergeFile(options.paths[i])) {
+            return 1;
+        }
+    }
+
+    if (!merged->save(options.mergedCoverage)) {
+        return 1;
+    }
+
+    std::cout << "Merged " << options.paths.size() << " coverage file(s) into " << options.mergedCoverage << "\n\n";
+    merged->writeSummary(std::cout);
+    return 0;
+}
+
+void printUsage()
+{
+    std::cout << "Usage : crnes-testrunner [--threads N] [--timeout FRAMES] [--coverage DIR] [rom or directory ...]\n"
+              << "        crnes-testrunner --merge-coverage OUT file.cov ...\n"
+              << "Runs blargg test ROMs concurrently (default testRoms) and reads their result at $6000.\n"
+              << "--merge-coverage combines coverage files of the same ROM and prints a summary per bank.\n";
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--threads" && hasValue) {
+            options.nbThreads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--timeout" && hasValue) {
+            options.timeoutFrames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--coverage" && hasValue) {
+            options.coverageDir = argv[++i];
+        } else if (arg == "--merge-coverage" && hasValue) {
+            options.mergedCoverage = argv[++i];
+        } else if (arg.compare(0, 2, "--") == 0 || arg == "-h") {
+            printUsage();
+            return 1;
+        } else {
+            options.paths.push_back(arg);
+        }
+    }
+
+    if (!options.mergedCoverage.empty()) {
+        return mergeCoverage(options);
+    }
+
+    if (options.paths.empty()) {
+        options.paths.push_back("testRoms");
+    }
+
+    //Test ROMs start from fresh RAM on every run
+    SaveRam::setFilesEnabled(false);
+
+    std::vector<std::string> roms = findRoms(options.paths);
+    if (roms.empty()) {
+        std::cout << "No ROM found." << std::endl;
+        return 1;
+    }
+
+    std::error_code error;
+    if (!options.coverageDir.empty() && !std::filesystem::is_directory(options.coverageDir, error)
+        && !std::filesystem::create_directories(options.coverageDir, error)) {
+        std::cout << "Cannot create coverage directory : " << options.coverageDir << std::endl;
+        return 1;
+    }
+
+    unsigned int nbThreads = options.nbThreads > 0 ? options.nbThreads : std::max(1u, std::thread::hardware_concurrency());
+    nbThreads = std::min<unsigned int>(nbThreads, roms.size());
+
+    std::vector<TestResult> results(roms.size());
+    std::atomic<size_t> nextRom(0);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < nbThreads; ++i) {
+        workers.emplace_back([&]() {
+            for (size_t rom = nextRom++; rom < roms.size(); rom = nextRom++) {
+                results[rom] = runTest(roms[rom], options);
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::left << std::setw(44) << "ROM" << std::setw(12) << "Result"
+              << std::right << std::setw(8) << "Frames" << std::setw(10) << "Time (s)" << "  Message\n";
+
+    unsigned int nbPassed = 0;
+    for (const auto& result : results) {
+        std::string outcome = outcomeName(result);
+        if (result.outcome == Outcome::FAIL) {
+            outcome += " #" + std::to_string(result.resultCode);
+        }
+        nbPassed += result.outcome == Outcome::PASS ? 1 : 0;
+
+        std::string name = std::filesystem::path(result.path).filename().string();
+        std::cout << std::left << std::setw(44) << name.substr(0, 43) << std::setw(12) << outcome
+                  << std::right << std::setw(8) << result.frames
+                  << std::setw(10) << std::fixed << std::setprecision(2) << result.seconds
+                  << "  " << firstLine(result.message) << "\n";
+    }
+
+    std::cout << "\n" << nbPassed << "/" << results.size() << " passed in " << std::setprecision(2) << totalSeconds
+              << "s on " << nbThreads << " threads" << std::endl;
+
+    return nbPassed == results.size() ? 0 : 1;
+}
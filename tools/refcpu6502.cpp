@@ -0,0 +1,534 @@
+#include "refcpu6502.h"
+
+#include <array>
+#include <cstdio>
+
+namespace
+{
+constexpr uint8_t flagC = 0x01;
+constexpr uint8_t flagZ = 0x02;
+constexpr uint8_t flagI = 0x04;
+constexpr uint8_t flagV = 0x40;
+constexpr uint8_t flagN = 0x80;
+
+struct Entry
+{
+    uint8_t opcode;
+    const char* mnemonic;
+    RefCpu6502::Operation op;
+    RefCpu6502::Mode mode;
+    uint8_t cycles;
+    bool pageCrossPenalty;
+};
+
+using R = RefCpu6502;
+
+//Documented opcodes with their base cycle count. Branches add their own cycles.
+const Entry entries[] = {
+    {0x69, "ADC", R::ADC, R::IMM, 2, false}, {0x65, "ADC", R::ADC, R::ZP, 3, false}, {0x75, "ADC", R::ADC, R::ZPX, 4, false},
+    {0x6D, "ADC", R::ADC, R::ABS, 4, false}, {0x7D, "ADC", R::ADC, R::ABX, 4, true}, {0x79, "ADC", R::ADC, R::ABY, 4, true},
+    {0x61, "ADC", R::ADC, R::IZX, 6, false}, {0x71, "ADC", R::ADC, R::IZY, 5, true},
+
+    {0x29, "AND", R::AND, R::IMM, 2, false}, {0x25, "AND", R::AND, R::ZP, 3, false}, {0x35, "AND", R::AND, R::ZPX, 4, false},
+    {0x2D, "AND", R::AND, R::ABS, 4, false}, {0x3D, "AND", R::AND, R::ABX, 4, true}, {0x39, "AND", R::AND, R::ABY, 4, true},
+    {0x21, "AND", R::AND, R::IZX, 6, false}, {0x31, "AND", R::AND, R::IZY, 5, true},
+
+    {0x0A, "ASL", R::ASL, R::ACC, 2, false}, {0x06, "ASL", R::ASL, R::ZP, 5, false}, {0x16, "ASL", R::ASL, R::ZPX, 6, false},
+    {0x0E, "ASL", R::ASL, R::ABS, 6, false}, {0x1E, "ASL", R::ASL, R::ABX, 7, false},
+
+    {0x90, "BCC", R::BCC, R::REL, 2, false}, {0xB0, "BCS", R::BCS, R::REL, 2, false}, {0xF0, "BEQ", R::BEQ, R::REL, 2, false},
+    {0x30, "BMI", R::BMI, R::REL, 2, false}, {0xD0, "BNE", R::BNE, R::REL, 2, false}, {0x10, "BPL", R::BPL, R::REL, 2, false},
+    {0x50, "BVC", R::BVC, R::REL, 2, false}, {0x70, "BVS", R::BVS, R::REL, 2, false},
+
+    {0x24, "BIT", R::BIT, R::ZP, 3, false}, {0x2C, "BIT", R::BIT, R::ABS, 4, false},
+
+    {0x00, "BRK", R::BRK, R::IMP, 7, false},
+
+    {0x18, "CLC", R::CLC, R::IMP, 2, false}, {0xD8, "CLD", R::CLD, R::IMP, 2, false},
+    {0x58, "CLI", R::CLI, R::IMP, 2, false}, {0xB8, "CLV", R::CLV, R::IMP, 2, false},
+
+    {0xC9, "CMP", R::CMP, R::IMM, 2, false}, {0xC5, "CMP", R::CMP, R::ZP, 3, false}, {0xD5, "CMP", R::CMP, R::ZPX, 4, false},
+    {0xCD, "CMP", R::CMP, R::ABS, 4, false}, {0xDD, "CMP", R::CMP, R::ABX, 4, true}, {0xD9, "CMP", R::CMP, R::ABY, 4, true},
+    {0xC1, "CMP", R::CMP, R::IZX, 6, false}, {0xD1, "CMP", R::CMP, R::IZY, 5, true},
+
+    {0xE0, "CPX", R::CPX, R::IMM, 2, false}, {0xE4, "CPX", R::CPX, R::ZP, 3, false}, {0xEC, "CPX", R::CPX, R::ABS, 4, false},
+    {0xC0, "CPY", R::CPY, R::IMM, 2, false}, {0xC4, "CPY", R::CPY, R::ZP, 3, false}, {0xCC, "CPY", R::CPY, R::ABS, 4, false},
+
+    {0xC6, "DEC", R::DEC, R::ZP, 5, false}, {0xD6, "DEC", R::DEC, R::ZPX, 6, false},
+    {0xCE, "DEC", R::DEC, R::ABS, 6, false}, {0xDE, "DEC", R::DEC, R::ABX, 7, false},
+    {0xCA, "DEX", R::DEX, R::IMP, 2, false}, {0x88, "DEY", R::DEY, R::IMP, 2, false},
+
+    {0x49, "EOR", R::EOR, R::IMM, 2, false}, {0x45, "EOR", R::EOR, R::ZP, 3, false}, {0x55, "EOR", R::EOR, R::ZPX, 4, false},
+    {0x4D, "EOR", R::EOR, R::ABS, 4, false}, {0x5D, "EOR", R::EOR, R::ABX, 4, true}, {0x59, "EOR", R::EOR, R::ABY, 4, true},
+    {0x41, "EOR", R::EOR, R::IZX, 6, false}, {0x51, "EOR", R::EOR, R::IZY, 5, true},
+
+    {0xE6, "INC", R::INC, R::ZP, 5, false}, {0xF6, "INC", R::INC, R::ZPX, 6, false},
+    {0xEE, "INC", R::INC, R::ABS, 6, false}, {0xFE, "INC", R::INC, R::ABX, 7, false},
+    {0xE8, "INX", R::INX, R::IMP, 2, false}, {0xC8, "INY", R::INY, R::IMP, 2, false},
+
+    {0x4C, "JMP", R::JMP, R::ABS, 3, false}, {0x6C, "JMP", R::JMP, R::IND, 5, false},
+    {0x20, "JSR", R::JSR, R::ABS, 6, false},
+
+    {0xA9, "LDA", R::LDA, R::IMM, 2, false}, {0xA5, "LDA", R::LDA, R::ZP, 3, false}, {0xB5, "LDA", R::LDA, R::ZPX, 4, false},
+    {0xAD, "LDA", R::LDA, R::ABS, 4, false}, {0xBD, "LDA", R::LDA, R::ABX, 4, true}, {0xB9, "LDA", R::LDA, R::ABY, 4, true},
+    {0xA1, "LDA", R::LDA, R::IZX, 6, false}, {0xB1, "LDA", R::LDA, R::IZY, 5, true},
+
+    {0xA2, "LDX", R::LDX, R::IMM, 2, false}, {0xA6, "LDX", R::LDX, R::ZP, 3, false}, {0xB6, "LDX", R::LDX, R::ZPY, 4, false},
+    {0xAE, "LDX", R::LDX, R::ABS, 4, false}, {0xBE, "LDX", R::LDX, R::ABY, 4, true},
+
+    {0xA0, "LDY", R::LDY, R::IMM, 2, false}, {0xA4, "LDY", R::LDY, R::ZP, 3, false}, {0xB4, "LDY", R::LDY, R::ZPX, 4, false},
+    {0xAC, "LDY", R::LDY, R::ABS, 4, false}, {0xBC, "LDY", R::LDY, R::ABX, 4, true},
+
+    {0x4A, "LSR", R::LSR, R::ACC, 2, false}, {0x46, "LSR", R::LSR, R::ZP, 5, false}, {0x56, "LSR", R::LSR, R::ZPX, 6, false},
+    {0x4E, "LSR", R::LSR, R::ABS, 6, false}, {0x5E, "LSR", R::LSR, R::ABX, 7, false},
+
+    {0xEA, "NOP", R::NOP, R::IMP, 2, false},
+
+    {0x09, "ORA", R::ORA, R::IMM, 2, false}, {0x05, "ORA", R::ORA, R::ZP, 3, false}, {0x15, "ORA", R::ORA, R::ZPX, 4, false},
+    {0x0D, "ORA", R::ORA, R::ABS, 4, false}, {0x1D, "ORA", R::ORA, R::ABX, 4, true}, {0x19, "ORA", R::ORA, R::ABY, 4, true},
+    {0x01, "ORA", R::ORA, R::IZX, 6, false}, {0x11, "ORA", R::ORA, R::IZY, 5, true},
+
+    {0x48, "PHA", R::PHA, R::IMP, 3, false}, {0x08, "PHP", R::PHP, R::IMP, 3, false},
+    {0x68, "PLA", R::PLA, R::IMP, 4, false}, {0x28, "PLP", R::PLP, R::IMP, 4, false},
+
+    {0x2A, "ROL", R::ROL, R::ACC, 2, false}, {0x26, "ROL", R::ROL, R::ZP, 5, false}, {0x36, "ROL", R::ROL, R::ZPX, 6, false},
+    {0x2E, "ROL", R::ROL, R::ABS, 6, false}, {0x3E, "ROL", R::ROL, R::ABX, 7, false},
+
+    {0x6A, "ROR", R::ROR, R::ACC, 2, false}, {0x66, "ROR", R::ROR, R::ZP, 5, false}, {0x76, "ROR", R::ROR, R::ZPX, 6, false},
+    {0x6E, "ROR", R::ROR, R::ABS, 6, false}, {0x7E, "ROR", R::ROR, R::ABX, 7, false},
+
+    {0x40, "RTI", R::RTI, R::IMP, 6, false}, {0x60, "RTS", R::RTS, R::IMP, 6, false},
+
+    {0xE9, "SBC", R::SBC, R::IMM, 2, false}, {0xE5, "SBC", R::SBC, R::ZP, 3, false}, {0xF5, "SBC", R::SBC, R::ZPX, 4, false},
+    {0xED, "SBC", R::SBC, R::ABS, 4, false}, {0xFD, "SBC", R::SBC, R::ABX, 4, true}, {0xF9, "SBC", R::SBC, R::ABY, 4, true},
+    {0xE1, "SBC", R::SBC, R::IZX, 6, false}, {0xF1, "SBC", R::SBC, R::IZY, 5, true},
+
+    {0x38, "SEC", R::SEC, R::IMP, 2, false}, {0xF8, "SED", R::SED, R::IMP, 2, false}, {0x78, "SEI", R::SEI, R::IMP, 2, false},
+
+    {0x85, "STA", R::STA, R::ZP, 3, false}, {0x95, "STA", R::STA, R::ZPX, 4, false}, {0x8D, "STA", R::STA, R::ABS, 4, false},
+    {0x9D, "STA", R::STA, R::ABX, 5, false}, {0x99, "STA", R::STA, R::ABY, 5, false},
+    {0x81, "STA", R::STA, R::IZX, 6, false}, {0x91, "STA", R::STA, R::IZY, 6, false},
+
+    {0x86, "STX", R::STX, R::ZP, 3, false}, {0x96, "STX", R::STX, R::ZPY, 4, false}, {0x8E, "STX", R::STX, R::ABS, 4, false},
+    {0x84, "STY", R::STY, R::ZP, 3, false}, {0x94, "STY", R::STY, R::ZPX, 4, false}, {0x8C, "STY", R::STY, R::ABS, 4, false},
+
+    {0xAA, "TAX", R::TAX, R::IMP, 2, false}, {0xA8, "TAY", R::TAY, R::IMP, 2, false}, {0xBA, "TSX", R::TSX, R::IMP, 2, false},
+    {0x8A, "TXA", R::TXA, R::IMP, 2, false}, {0x9A, "TXS", R::TXS, R::IMP, 2, false}, {0x98, "TYA", R::TYA, R::IMP, 2, false},
+};
+
+const std::array<RefCpu6502::Instruction, 0x100>& table()
+{
+    static const std::array<RefCpu6502::Instruction, 0x100> instructions = []() {
+        std::array<RefCpu6502::Instruction, 0x100> result;
+        result.fill({"???", R::UND, R::IMP, 0, false});
+
+        for (const auto& entry : entries) {
+            result[entry.opcode] = {entry.mnemonic, entry.op, entry.mode, entry.cycles, entry.pageCrossPenalty};
+        }
+        return result;
+    }();
+
+    return instructions;
+}
+}
+
+bool RefCpu6502::isDocumented(uint8_t opcode)
+{
+    return table()[opcode].op != UND;
+}
+
+const RefCpu6502::Instruction& RefCpu6502::instruction(uint8_t opcode)
+{
+    return table()[opcode];
+}
+
+unsigned int RefCpu6502::length(uint8_t opcode)
+{
+    switch (table()[opcode].mode) {
+    case IMP:
+    case ACC:
+        return 1;
+    case ABS:
+    case ABX:
+    case ABY:
+    case IND:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+std::string RefCpu6502::disassemble(const uint8_t* bytes, uint16_t PC)
+{
+    const Instruction& inst = table()[bytes[0]];
+    unsigned int word = length(bytes[0]) == 3 ? bytes[1] | (bytes[2] << 8) : 0;
+    char text[32];
+
+    switch (inst.mode) {
+    case IMP:
+        std::snprintf(text, sizeof(text), "%s", inst.mnemonic);
+        break;
+    case ACC:
+        std::snprintf(text, sizeof(text), "%s A", inst.mnemonic);
+        break;
+    case IMM:
+        std::snprintf(text, sizeof(text), "%s #$%02X", inst.mnemonic, bytes[1]);
+        break;
+    case ZP:
+        std::snprintf(text, sizeof(text), "%s $%02X", inst.mnemonic, bytes[1]);
+        break;
+    case ZPX:
+        std::snprintf(text, sizeof(text), "%s $%02X,X", inst.mnemonic, bytes[1]);
+        break;
+    case ZPY:
+        std::snprintf(text, sizeof(text), "%s $%02X,Y", inst.mnemonic, bytes[1]);
+        break;
+    case REL:
+        std::snprintf(text, sizeof(text), "%s $%04X", inst.mnemonic, (PC + 2 + static_cast<int8_t>(bytes[1])) & 0xFFFF);
+        break;
+    case ABS:
+        std::snprintf(text, sizeof(text), "%s $%04X", inst.mnemonic, word);
+        break;
+    case ABX:
+        std::snprintf(text, sizeof(text), "%s $%04X,X", inst.mnemonic, word);
+        break;
+    case ABY:
+        std::snprintf(text, sizeof(text), "%s $%04X,Y", inst.mnemonic, word);
+        break;
+    case IND:
+        std::snprintf(text, sizeof(text), "%s ($%04X)", inst.mnemonic, word);
+        break;
+    case IZX:
+        std::snprintf(text, sizeof(text), "%s ($%02X,X)", inst.mnemonic, bytes[1]);
+        break;
+    case IZY:
+        std::snprintf(text, sizeof(text), "%s ($%02X),Y", inst.mnemonic, bytes[1]);
+        break;
+    }
+
+    return text;
+}
+
+void RefCpu6502::setZN(uint8_t value)
+{
+    setFlag(flagZ, value == 0);
+    setFlag(flagN, value & 0x80);
+}
+
+void RefCpu6502::setFlag(uint8_t flag, bool set)
+{
+    state.P = set ? state.P | flag : state.P & ~flag;
+}
+
+void RefCpu6502::adc(uint8_t value)
+{
+    unsigned int sum = state.A + value + (state.P & flagC);
+
+    setFlag(flagV, ~(state.A ^ value) & (state.A ^ sum) & 0x80);
+    setFlag(flagC, sum > 0xFF);
+    state.A = static_cast<uint8_t>(sum);
+    setZN(state.A);
+}
+
+void RefCpu6502::compare(uint8_t reg, uint8_t value)
+{
+    setFlag(flagC, reg >= value);
+    setZN(static_cast<uint8_t>(reg - value));
+}
+
+unsigned int RefCpu6502::branch(bool condition, uint8_t offset)
+{
+    if (!condition) {
+        return 0;
+    }
+
+    uint16_t target = state.PC + static_cast<int8_t>(offset);
+    unsigned int extra = (target & 0xFF00) != (state.PC & 0xFF00) ? 2 : 1;
+    state.PC = target;
+
+    return extra;
+}
+
+unsigned int RefCpu6502::step()
+{
+    const Instruction& inst = table()[fetch()];
+    unsigned int cycles = inst.cycles;
+    uint16_t addr = 0;
+    uint16_t base = 0;
+    uint8_t lo, hi;
+
+    switch (inst.mode) {
+    case IMP:
+    case ACC:
+        break;
+    case IMM:
+    case REL:
+        addr = state.PC++;
+        break;
+    case ZP:
+        addr = fetch();
+        break;
+    case ZPX:
+        addr = (fetch() + state.X) & 0xFF;
+        break;
+    case ZPY:
+        addr = (fetch() + state.Y) & 0xFF;
+        break;
+    case ABS:
+        lo = fetch();
+        hi = fetch();
+        addr = lo | (hi << 8);
+        break;
+    case ABX:
+    case ABY:
+        lo = fetch();
+        hi = fetch();
+        base = lo | (hi << 8);
+        addr = base + (inst.mode == ABX ? state.X : state.Y);
+        break;
+    case IND:
+        lo = fetch();
+        hi = fetch();
+        base = lo | (hi << 8);
+        //The high byte is fetched without carrying into the page
+        addr = memory.read(base) | (memory.read((base & 0xFF00) | ((base + 1) & 0xFF)) << 8);
+        break;
+    case IZX:
+        lo = (fetch() + state.X) & 0xFF;
+        addr = memory.read(lo) | (memory.read((lo + 1) & 0xFF) << 8);
+        break;
+    case IZY:
+        lo = fetch();
+        base = memory.read(lo) | (memory.read((lo + 1) & 0xFF) << 8);
+        addr = base + state.Y;
+        break;
+    }
+
+    if (inst.pageCrossPenalty && (base & 0xFF00) != (addr & 0xFF00)) {
+        ++cycles;
+    }
+
+    uint8_t value;
+
+    switch (inst.op) {
+    case ADC:
+        adc(memory.read(addr));
+        break;
+    case AND:
+        state.A &= memory.read(addr);
+        setZN(state.A);
+        break;
+    case ASL:
+    case LSR:
+    case ROL:
+    case ROR: {
+        value = inst.mode == ACC ? state.A : memory.read(addr);
+        bool carry = state.P & flagC;
+
+        if (inst.op == ASL || inst.op == ROL) {
+            setFlag(flagC, value & 0x80);
+            value = (value << 1) | (inst.op == ROL && carry ? 0x01 : 0x00);
+        } else {
+            setFlag(flagC, value & 0x01);
+            value = (value >> 1) | (inst.op == ROR && carry ? 0x80 : 0x00);
+        }
+
+        setZN(value);
+        if (inst.mode == ACC) {
+            state.A = value;
+        } else {
+            memory.write(addr, value);
+        }
+        break;
+    }
+    case BCC:
+        cycles += branch(!flag(flagC), memory.read(addr));
+        break;
+    case BCS:
+        cycles += branch(flag(flagC), memory.read(addr));
+        break;
+    case BEQ:
+        cycles += branch(flag(flagZ), memory.read(addr));
+        break;
+    case BMI:
+        cycles += branch(flag(flagN), memory.read(addr));
+        break;
+    case BNE:
+        cycles += branch(!flag(flagZ), memory.read(addr));
+        break;
+    case BPL:
+        cycles += branch(!flag(flagN), memory.read(addr));
+        break;
+    case BVC:
+        cycles += branch(!flag(flagV), memory.read(addr));
+        break;
+    case BVS:
+        cycles += branch(flag(flagV), memory.read(addr));
+        break;
+    case BIT:
+        value = memory.read(addr);
+        setFlag(flagZ, (state.A & value) == 0);
+        setFlag(flagV, value & 0x40);
+        setFlag(flagN, value & 0x80);
+        break;
+    case BRK:
+        //The byte after BRK is skipped
+        ++state.PC;
+        push(state.PC >> 8);
+        push(state.PC & 0xFF);
+        push(state.P | 0x30);
+        setFlag(flagI, true);
+        lo = memory.read(0xFFFE);
+        hi = memory.read(0xFFFF);
+        state.PC = lo | (hi << 8);
+        break;
+    case CLC:
+        setFlag(flagC, false);
+        break;
+    case CLD:
+        setFlag(0x08, false);
+        break;
+    case CLI:
+        setFlag(flagI, false);
+        break;
+    case CLV:
+        setFlag(flagV, false);
+        break;
+    case CMP:
+        compare(state.A, memory.read(addr));
+        break;
+    case CPX:
+        compare(state.X, memory.read(addr));
+        break;
+    case CPY:
+        compare(state.Y, memory.read(addr));
+        break;
+    case DEC:
+        value = memory.read(addr) - 1;
+        memory.write(addr, value);
+        setZN(value);
+        break;
+    case DEX:
+        setZN(--state.X);
+        break;
+    case DEY:
+        setZN(--state.Y);
+        break;
+    case EOR:
+        state.A ^= memory.read(addr);
+        setZN(state.A);
+        break;
+    case INC:
+        value = memory.read(addr) + 1;
+        memory.write(addr, value);
+        setZN(value);
+        break;
+    case INX:
+        setZN(++state.X);
+        break;
+    case INY:
+        setZN(++state.Y);
+        break;
+    case JMP:
+        state.PC = addr;
+        break;
+    case JSR:
+        //Pushes the address of the last byte of the instruction
+        --state.PC;
+        push(state.PC >> 8);
+        push(state.PC & 0xFF);
+        state.PC = addr;
+        break;
+    case LDA:
+        state.A = memory.read(addr);
+        setZN(state.A);
+        break;
+    case LDX:
+        state.X = memory.read(addr);
+        setZN(state.X);
+        break;
+    case LDY:
+        state.Y = memory.read(addr);
+        setZN(state.Y);
+        break;
+    case NOP:
+        break;
+    case ORA:
+        state.A |= memory.read(addr);
+        setZN(state.A);
+        break;
+    case PHA:
+        push(state.A);
+        break;
+    case PHP:
+        push(state.P | 0x30);
+        break;
+    case PLA:
+        state.A = pull();
+        setZN(state.A);
+        break;
+    case PLP:
+        //Bits 4 and 5 don't exist in the register
+        state.P = (pull() & 0xCF) | (state.P & 0x30);
+        break;
+    case RTI:
+        state.P = (pull() & 0xCF) | (state.P & 0x30);
+        lo = pull();
+        hi = pull();
+        state.PC = lo | (hi << 8);
+        break;
+    case RTS:
+        lo = pull();
+        hi = pull();
+        state.PC = (lo | (hi << 8)) + 1;
+        break;
+    case SBC:
+        adc(memory.read(addr) ^ 0xFF);
+        break;
+    case SEC:
+        setFlag(flagC, true);
+        break;
+    case SED:
+        setFlag(0x08, true);
+        break;
+    case SEI:
+        setFlag(flagI, true);
+        break;
+    case STA:
+        memory.write(addr, state.A);
+        break;
+    case STX:
+        memory.write(addr, state.X);
+        break;
+    case STY:
+        memory.write(addr, state.Y);
+        break;
+    case TAX:
+        state.X = state.A;
+        setZN(state.X);
+        break;
+    case TAY:
+        state.Y = state.A;
+        setZN(state.Y);
+        break;
+    case TSX:
+        state.X = state.S;
+        setZN(state.X);
+        break;
+    case TXA:
+        state.A = state.X;
+        setZN(state.A);
+        break;
+    case TXS:
+        state.S = state.X;
+        break;
+    case TYA:
+        state.A = state.Y;
+        setZN(state.A);
+        break;
+    case UND:
+        break;
+    }
+
+    return cycles;
+}
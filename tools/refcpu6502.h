@@ -0,0 +1,116 @@
+#ifndef REFCPU6502_H
+#define REFCPU6502_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Reference 6502 used by crnes-fuzz. It shares no code with Cpu on purpose : it models the
+//architectural effect of each documented instruction (2A03 flavour, no decimal mode) and
+//its documented cycle count, not the individual bus cycles.
+
+struct RefWrite
+{
+    uint16_t addr;
+    uint8_t data;
+
+    bool operator==(const RefWrite& other) const { return addr == other.addr && data == other.data; }
+};
+
+//Same decoding as the fuzzer's CpuBus setup : 2KB RAM mirrored up to $1FFF, nothing from $2000
+//to $5FFF, 8KB PRG-RAM at $6000 and 32KB read-only PRG-ROM at $8000.
+class RefMemory
+{
+public:
+    uint8_t ram[0x800];
+    uint8_t prgRam[0x2000];
+    const uint8_t* prgRom;
+
+    std::vector<RefWrite> writes;
+
+    uint8_t read(uint16_t addr) const
+    {
+        if (addr < 0x2000) {
+            return ram[addr & 0x7FF];
+        } else if (addr < 0x6000) {
+            return 0;
+        } else if (addr < 0x8000) {
+            return prgRam[addr - 0x6000];
+        }
+        return prgRom[addr - 0x8000];
+    }
+
+    void write(uint16_t addr, uint8_t data)
+    {
+        writes.push_back({addr, data});
+
+        if (addr < 0x2000) {
+            ram[addr & 0x7FF] = data;
+        } else if (addr >= 0x6000 && addr < 0x8000) {
+            prgRam[addr - 0x6000] = data;
+        }
+    }
+};
+
+struct RefState
+{
+    uint16_t PC;
+    uint8_t A;
+    uint8_t X;
+    uint8_t Y;
+    uint8_t S;
+    uint8_t P;
+};
+
+class RefCpu6502
+{
+public:
+    enum Mode { IMP, ACC, IMM, ZP, ZPX, ZPY, REL, ABS, ABX, ABY, IND, IZX, IZY };
+
+    enum Operation
+    {
+        UND,
+        ADC, AND, ASL, BCC, BCS, BEQ, BIT, BMI, BNE, BPL, BRK, BVC, BVS, CLC,
+        CLD, CLI, CLV, CMP, CPX, CPY, DEC, DEX, DEY, EOR, INC, INX, INY, JMP,
+        JSR, LDA, LDX, LDY, LSR, NOP, ORA, PHA, PHP, PLA, PLP, ROL, ROR, RTI,
+        RTS, SBC, SEC, SED, SEI, STA, STX, STY, TAX, TAY, TSX, TXA, TXS, TYA
+    };
+
+    struct Instruction
+    {
+        const char* mnemonic;
+        Operation op;
+        Mode mode;
+        uint8_t cycles;
+        bool pageCrossPenalty;
+    };
+
+    explicit RefCpu6502(RefMemory& memory) : state{0, 0, 0, 0, 0, 0}, memory(memory) {}
+
+    RefState state;
+
+    //Executes one instruction and returns the number of cycles it took
+    unsigned int step();
+
+    static bool isDocumented(uint8_t opcode);
+    static const Instruction& instruction(uint8_t opcode);
+    static unsigned int length(uint8_t opcode);
+    static std::string disassemble(const uint8_t* bytes, uint16_t PC);
+
+private:
+    RefMemory& memory;
+
+    uint8_t fetch() { return memory.read(state.PC++); }
+    void push(uint8_t data) { memory.write(0x100 | state.S--, data); }
+    uint8_t pull() { return memory.read(0x100 | ++state.S); }
+
+    void setZN(uint8_t value);
+    void setFlag(uint8_t flag, bool set);
+    bool flag(uint8_t flag) const { return state.P & flag; }
+
+    void adc(uint8_t value);
+    void compare(uint8_t reg, uint8_t value);
+    unsigned int branch(bool condition, uint8_t offset);
+};
+
+#endif